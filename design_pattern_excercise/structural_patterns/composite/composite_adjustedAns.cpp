@@ -2,76 +2,1846 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <shared_mutex>
+#include <string_view>
+#include <cstdint>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <stdexcept>
+#include <array>
 
 using namespace std;
 
+class Department;
+class Employee;
+class DepartmentComponent;
+
+// 组织树结构变化的监听接口，只挂在根部门上，用于维护二级索引等附加结构
+class OrgObserver
+{
+public:
+    virtual ~OrgObserver() = default;
+    virtual void onAttach(DepartmentComponent& subtree) = 0;
+    virtual void onDetach(DepartmentComponent& subtree) = 0;
+    virtual void onSalaryChanged(Employee& employee, int oldSalary) = 0;
+};
+
 class DepartmentComponent
 {
 public:
-    virtual int calculateSalary() = 0;
-    virtual void display(int depth = 0) = 0;
-    virtual void add(std::unique_ptr<DepartmentComponent> component) {}
-    virtual void remove(DepartmentComponent* component) {}
+    virtual ~DepartmentComponent() = default;
+    // 返回子树薪资总额，部门节点直接返回缓存值
+    virtual long long calculateSalary() = 0;
+    // 递归重新计算子树薪资总额，不使用缓存，用于校验
+    virtual long long recalculateSalary() = 0;
+    virtual void display(int depth = 0) = 0;
+    virtual const string& getName() const = 0;
+    virtual void add(std::unique_ptr<DepartmentComponent> component) {}
+    virtual void remove(DepartmentComponent* component) {}
+    // 遍历接口：叶节点没有子节点
+    virtual bool isComposite() const { return false; }
+    virtual size_t getChildCount() const { return 0; }
+    virtual DepartmentComponent* getChild(size_t /*index*/) const { return nullptr; }
+    // 子树节点数（含自身），部门节点同样缓存该值
+    virtual size_t getNodeCount() const { return 1; }
+
+    Department* getParent() const { return _parent; }
+
+protected:
+    friend class Department;
+    friend class OrgChart;
+    Department* _parent = nullptr;
+    size_t _indexInParent = 0;          // 在父部门_children中的位置，删除时O(1)定位
+    uint32_t _handleSlot = UINT32_MAX;  // 在OrgChart句柄表中的槽位
+};
+
+/**
+ * 部门节点缓存整棵子树的薪资总额
+ * add、remove以及员工调薪时，把变化量沿父指针逐级向上累加，
+ * 查询为O(1)，更新为O(depth)
+ * 每个子节点记录自己在_children中的下标，删除时与末尾元素交换后弹出，
+ * 不再线性查找，代价是删除后兄弟节点的顺序会改变
+ */
+class Department : public DepartmentComponent
+{
+public:
+    Department(string name) : _name(name) {}
+    long long calculateSalary() override
+    {
+        return _totalSalary;
+    }
+    long long recalculateSalary() override
+    {
+        long long totalSalary = 0;
+        for (const auto& child : _children)
+        {
+            totalSalary += child->recalculateSalary();
+        }
+        return totalSalary;
+    }
+    void display(int depth) override
+    {
+        std::cout << std::string(depth * 2 + 1, '-') << " " << _name << std::endl;
+        for (const auto& child : _children)
+        {
+            child->display(depth+1);
+        }
+    }
+    void add(std::unique_ptr<DepartmentComponent> component) override
+    {
+        attach(move(component), true);
+    }
+    void remove(DepartmentComponent* component) override 
+    {
+        detach(component);
+    }
+    // 从本部门摘下子节点并交出所有权，子树本身不拷贝，可直接add到其他部门
+    // notify为false时不通知监听者，用于同一棵树内部的调岗
+    std::unique_ptr<DepartmentComponent> detach(DepartmentComponent* component, bool notify = true)
+    {
+        if (component == nullptr || component->_parent != this) return nullptr;
+        size_t index = component->_indexInParent;
+        std::unique_ptr<DepartmentComponent> detached = move(_children[index]);
+        if (index + 1 != _children.size())
+        {
+            _children[index] = move(_children.back());
+            _children[index]->_indexInParent = index;
+        }
+        _children.pop_back();
+        detached->_parent = nullptr;
+        Department* root = propagateDelta(-detached->calculateSalary(),
+                                          -static_cast<long long>(detached->getNodeCount()));
+        if (notify)
+        {
+            if (root->_chart) root->_chart->onDetach(*detached);
+            if (root->_observer) root->_observer->onDetach(*detached);
+        }
+        return detached;
+    }
+    void attach(std::unique_ptr<DepartmentComponent> component, bool notify)
+    {
+        if (!component) return;
+        DepartmentComponent* raw = component.get();
+        component->_parent = this;
+        component->_indexInParent = _children.size();
+        long long delta = component->calculateSalary();
+        size_t nodes = component->getNodeCount();
+        _children.push_back(move(component));
+        Department* root = propagateDelta(delta, static_cast<long long>(nodes));
+        if (notify)
+        {
+            if (root->_chart) root->_chart->onAttach(*raw);
+            if (root->_observer) root->_observer->onAttach(*raw);
+        }
+    }
+    const string& getName() const override { return _name; }
+    bool isComposite() const override { return true; }
+    size_t getChildCount() const override { return _children.size(); }
+    DepartmentComponent* getChild(size_t index) const override { return _children[index].get(); }
+    size_t getNodeCount() const override { return _nodeCount; }
+
+    // 把子树薪资与节点数的变化量累加到自身及所有祖先，返回根部门
+    Department* propagateDelta(long long delta, long long nodeDelta = 0)
+    {
+        Department* dep = this;
+        for (;;)
+        {
+            dep->_totalSalary += delta;
+            dep->_nodeCount += nodeDelta;
+            if (dep->_parent == nullptr) return dep;
+            dep = dep->_parent;
+        }
+    }
+
+    // 监听者只在根部门上生效
+    OrgObserver* getObserver() const { return _observer; }
+    void setObserver(OrgObserver* observer) { _observer = observer; }
+
+private:
+    friend class OrgChart;
+    string _name;
+    vector<std::unique_ptr<DepartmentComponent>> _children;
+    long long _totalSalary = 0;
+    size_t _nodeCount = 1;
+    OrgObserver* _observer = nullptr;
+    // 根部门被OrgChart管理时指向其句柄表，与_observer分开，二者可以同时存在
+    OrgObserver* _chart = nullptr;
+};
+
+class Employee : public DepartmentComponent
+{
+public:
+    Employee(string name, int salary) : _name(name), _salary(salary) {}
+    long long calculateSalary() override
+    {
+        return _salary;
+    }
+    long long recalculateSalary() override
+    {
+        return _salary;
+    }
+    void display(int depth) override
+    {
+        cout << string(depth * 2 + 1, '-') << " 员工" << _name << endl;
+    }
+    const string& getName() const override { return _name; }
+    int getSalary() const { return _salary; }
+    void setSalary(int salary)
+    {
+        long long delta = static_cast<long long>(salary) - _salary;
+        int oldSalary = _salary;
+        _salary = salary;
+        if (_parent == nullptr) return;
+        Department* root = _parent->propagateDelta(delta);
+        if (root->getObserver()) root->getObserver()->onSalaryChanged(*this, oldSalary);
+    }
+
+private:
+    string _name;
+    int _salary;
+};
+
+/**
+ * 组织树的二级索引：姓名哈希索引与薪资有序索引，可分别开启
+ * 挂在根部门上作为监听者，add、remove和调岗后自动维护；索引只记录员工指针，
+ * 所属部门的路径在查询时沿父指针回溯得到，因此同一棵树内的调岗不需要更新索引。
+ * 索引对象必须先于组织树析构。
+ */
+class OrgIndex : public OrgObserver
+{
+public:
+    struct Match
+    {
+        Employee* employee;
+        vector<Department*> path; // 从根部门到所在部门
+    };
+
+    OrgIndex(Department& root, bool indexName = true, bool indexSalary = true)
+        : _root(root), _indexName(indexName), _indexSalary(indexSalary)
+    {
+        if (root.getParent() != nullptr || root.getObserver() != nullptr)
+        {
+            throw std::invalid_argument("Index must be attached to an unobserved root department");
+        }
+        onAttach(root);
+        root.setObserver(this);
+    }
+
+    ~OrgIndex() override
+    {
+        _root.setObserver(nullptr);
+    }
+
+    OrgIndex(const OrgIndex&) = delete;
+    OrgIndex& operator=(const OrgIndex&) = delete;
+
+    vector<Match> findByName(const string& name) const
+    {
+        if (!_indexName) throw std::logic_error("Name index is disabled");
+        vector<Match> result;
+        auto range = _byName.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it) result.push_back(makeMatch(it->second));
+        return result;
+    }
+
+    // 薪资在闭区间[low, high]内的员工，按薪资升序
+    vector<Match> findBySalary(int low, int high) const
+    {
+        if (!_indexSalary) throw std::logic_error("Salary index is disabled");
+        vector<Match> result;
+        for (auto it = _bySalary.lower_bound(low); it != _bySalary.end() && it->first <= high; ++it)
+        {
+            result.push_back(makeMatch(it->second));
+        }
+        return result;
+    }
+
+    static string formatPath(const Match& match)
+    {
+        string path;
+        for (Department* dep : match.path)
+        {
+            path += dep->getName();
+            path += '/';
+        }
+        return path + match.employee->getName();
+    }
+
+    void onAttach(DepartmentComponent& subtree) override
+    {
+        // 只为大批量挂入预留空间，逐个add时交给容器自身按倍数扩容
+        size_t expected = subtree.getNodeCount();
+        if (expected > 1024)
+        {
+            if (_indexName) _byName.reserve(_byName.size() + expected);
+            if (_indexSalary) _salaryPos.reserve(_salaryPos.size() + expected);
+        }
+        forEachEmployee(subtree, [this](Employee& employee) {
+            if (_indexName) _byName.emplace(employee.getName(), &employee);
+            if (_indexSalary) _salaryPos[&employee] = _bySalary.emplace(employee.getSalary(), &employee);
+        });
+    }
+
+    void onDetach(DepartmentComponent& subtree) override
+    {
+        forEachEmployee(subtree, [this](Employee& employee) {
+            if (_indexName) eraseName(employee);
+            if (_indexSalary)
+            {
+                auto pos = _salaryPos.find(&employee);
+                if (pos == _salaryPos.end()) return;
+                _bySalary.erase(pos->second);
+                _salaryPos.erase(pos);
+            }
+        });
+    }
+
+    // 不在索引中的员工（例如尚未挂入本树）直接忽略
+    void onSalaryChanged(Employee& employee, int /*oldSalary*/) override
+    {
+        if (!_indexSalary) return;
+        auto pos = _salaryPos.find(&employee);
+        if (pos == _salaryPos.end()) return;
+        _bySalary.erase(pos->second);
+        pos->second = _bySalary.emplace(employee.getSalary(), &employee);
+    }
+
+private:
+    Department& _root;
+    bool _indexName;
+    bool _indexSalary;
+    unordered_multimap<string, Employee*> _byName;
+    multimap<int, Employee*> _bySalary;
+    unordered_map<Employee*, multimap<int, Employee*>::iterator> _salaryPos;
+
+    template <typename Fn>
+    static void forEachEmployee(DepartmentComponent& root, Fn fn)
+    {
+        vector<DepartmentComponent*> stack{&root};
+        while (!stack.empty())
+        {
+            DepartmentComponent* node = stack.back();
+            stack.pop_back();
+            if (!node->isComposite()) fn(static_cast<Employee&>(*node));
+            for (size_t i = 0; i < node->getChildCount(); ++i) stack.push_back(node->getChild(i));
+        }
+    }
+
+    void eraseName(Employee& employee)
+    {
+        auto range = _byName.equal_range(employee.getName());
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == &employee)
+            {
+                _byName.erase(it);
+                return;
+            }
+        }
+    }
+
+    static Match makeMatch(Employee* employee)
+    {
+        Match match{employee, {}};
+        for (Department* dep = employee->getParent(); dep != nullptr; dep = dep->getParent())
+        {
+            match.path.push_back(dep);
+        }
+        std::reverse(match.path.begin(), match.path.end());
+        return match;
+    }
+};
+
+// 代际句柄：槽位被复用时代数加一，旧句柄随之失效
+struct NodeHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+/**
+ * 带稳定句柄的组织架构
+ * 句柄表按槽位存放节点指针，查找、删除、调岗都是O(1)定位，
+ * 再加上沿祖先更新缓存总额的O(depth)；调岗时整棵子树直接转移所有权，不做拷贝。
+ * 句柄表通过根部门的结构变化通知维护，因此直接调用Department::add/remove/detach
+ * 挂入或摘下的节点同样会分配或释放句柄，不会留下指向已释放节点的槽位。
+ */
+class OrgChart : private OrgObserver
+{
+public:
+    explicit OrgChart(unique_ptr<Department> root) : _root(move(root))
+    {
+        registerSubtree(_root.get());
+        _root->_chart = this;
+    }
+
+    ~OrgChart() override
+    {
+        _root->_chart = nullptr;
+    }
+
+    OrgChart(const OrgChart&) = delete;
+    OrgChart& operator=(const OrgChart&) = delete;
+
+    Department* getRoot() const { return _root.get(); }
+    NodeHandle rootHandle() const { return handleOf(_root.get()); }
+
+    DepartmentComponent* get(NodeHandle handle) const
+    {
+        if (handle.index >= _slots.size()) return nullptr;
+        const Slot& slot = _slots[handle.index];
+        return slot.generation == handle.generation ? slot.node : nullptr;
+    }
+
+    NodeHandle handleOf(const DepartmentComponent* node) const
+    {
+        if (node == nullptr || node->_handleSlot >= _slots.size()) return NodeHandle{};
+        return NodeHandle{node->_handleSlot, _slots[node->_handleSlot].generation};
+    }
+
+    // 挂到parent下，为新子树中的每个节点分配句柄，返回子树根的句柄
+    NodeHandle add(NodeHandle parent, unique_ptr<DepartmentComponent> component)
+    {
+        Department* dep = asDepartment(get(parent));
+        if (dep == nullptr || !component) return NodeHandle{};
+        DepartmentComponent* raw = component.get();
+        dep->add(move(component));
+        return handleOf(raw);
+    }
+
+    // 摘下子树并交出所有权，子树中所有句柄失效
+    unique_ptr<DepartmentComponent> extract(NodeHandle handle)
+    {
+        DepartmentComponent* node = get(handle);
+        if (node == nullptr || node->getParent() == nullptr) return nullptr;
+        return node->getParent()->detach(node);
+    }
+
+    bool remove(NodeHandle handle)
+    {
+        return extract(handle) != nullptr;
+    }
+
+    // 调岗：子树整体转移到新部门，句柄保持有效
+    bool transfer(NodeHandle handle, NodeHandle newParent)
+    {
+        DepartmentComponent* node = get(handle);
+        Department* dep = asDepartment(get(newParent));
+        if (node == nullptr || dep == nullptr || node->getParent() == nullptr) return false;
+        // 不能移动到自己的子树中
+        for (DepartmentComponent* p = dep; p != nullptr; p = p->getParent())
+        {
+            if (p == node) return false;
+        }
+        if (node->getParent() == dep) return true;
+        // 同一棵树内调岗，不需要通知索引等监听者
+        dep->attach(node->getParent()->detach(node, false), false);
+        return true;
+    }
+
+    size_t liveHandles() const { return _slots.size() - _freeCount; }
+
+private:
+    struct Slot
+    {
+        DepartmentComponent* node = nullptr;
+        uint32_t generation = 0;
+        uint32_t nextFree = UINT32_MAX;
+    };
+
+    unique_ptr<Department> _root;
+    vector<Slot> _slots;
+    uint32_t _freeHead = UINT32_MAX;
+    size_t _freeCount = 0;
+
+    static Department* asDepartment(DepartmentComponent* node)
+    {
+        return node != nullptr && node->isComposite() ? static_cast<Department*>(node) : nullptr;
+    }
+
+    void onAttach(DepartmentComponent& subtree) override { registerSubtree(&subtree); }
+    void onDetach(DepartmentComponent& subtree) override { releaseSubtree(&subtree); }
+    void onSalaryChanged(Employee&, int) override {}
+
+    void registerSubtree(DepartmentComponent* root)
+    {
+        vector<DepartmentComponent*> stack{root};
+        while (!stack.empty())
+        {
+            DepartmentComponent* node = stack.back();
+            stack.pop_back();
+            uint32_t index;
+            if (_freeHead != UINT32_MAX)
+            {
+                index = _freeHead;
+                _freeHead = _slots[index].nextFree;
+                --_freeCount;
+            }
+            else
+            {
+                index = static_cast<uint32_t>(_slots.size());
+                _slots.emplace_back();
+            }
+            _slots[index].node = node;
+            node->_handleSlot = index;
+            for (size_t i = 0; i < node->getChildCount(); ++i) stack.push_back(node->getChild(i));
+        }
+    }
+
+    void releaseSubtree(DepartmentComponent* root)
+    {
+        vector<DepartmentComponent*> stack{root};
+        while (!stack.empty())
+        {
+            DepartmentComponent* node = stack.back();
+            stack.pop_back();
+            Slot& slot = _slots[node->_handleSlot];
+            slot.node = nullptr;
+            ++slot.generation;
+            slot.nextFree = _freeHead;
+            _freeHead = node->_handleSlot;
+            ++_freeCount;
+            node->_handleSlot = UINT32_MAX;
+            for (size_t i = 0; i < node->getChildCount(); ++i) stack.push_back(node->getChild(i));
+        }
+    }
+};
+
+/**
+ * 工作窃取的fork-join线程池
+ * 每个工作线程有自己的任务双端队列：自己从尾部压入和弹出，空闲时从其他线程的头部窃取。
+ * 调用run()的线程作为0号工作线程参与计算，等待子任务时也会继续执行其他任务，不会空等。
+ */
+class ForkJoinPool
+{
+public:
+    // 侵入式任务：调用方把Task嵌入自己的数据结构，run收到的就是该Task，派生任务不需要额外分配
+    struct Task
+    {
+        void (*run)(Task&) = nullptr;
+        std::atomic<bool> done{false};
+    };
+
+    explicit ForkJoinPool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        : _queues(std::max(1u, threads))
+    {
+        for (unsigned i = 1; i < _queues.size(); ++i)
+        {
+            _workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~ForkJoinPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            _stop = true;
+        }
+        _stateCv.notify_all();
+        for (auto& worker : _workers) worker.join();
+    }
+
+    ForkJoinPool(const ForkJoinPool&) = delete;
+    ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(_queues.size()); }
+
+    // 在线程池中执行fn，返回时fn及其派生的全部任务都已完成
+    template <typename Fn>
+    void run(Fn fn)
+    {
+        std::lock_guard<std::mutex> runLock(_runMutex);
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            _running = true;
+        }
+        _stateCv.notify_all();
+        tlsPool = this;
+        tlsIndex = 0;
+        fn();
+        tlsPool = nullptr;
+        _running = false;
+    }
+
+    // 只能在run()执行期间、由池内线程调用
+    void spawn(Task& task)
+    {
+        WorkQueue& queue = _queues[tlsIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(&task);
+    }
+
+    void wait(Task& task)
+    {
+        while (!task.done.load(std::memory_order_acquire))
+        {
+            if (!runOne(tlsIndex)) std::this_thread::yield();
+        }
+    }
+
+private:
+    struct alignas(64) WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+    };
+
+    std::vector<WorkQueue> _queues;
+    std::vector<std::thread> _workers;
+    std::mutex _runMutex;
+    std::mutex _stateMutex;
+    std::condition_variable _stateCv;
+    std::atomic<bool> _running{false};
+    bool _stop = false;
+
+    static thread_local ForkJoinPool* tlsPool;
+    static thread_local unsigned tlsIndex;
+
+    static void execute(Task* task)
+    {
+        task->run(*task);
+        task->done.store(true, std::memory_order_release);
+    }
+
+    // 先取自己队列尾部的任务，没有再依次窃取其他队列头部的任务
+    bool runOne(unsigned self)
+    {
+        Task* task = nullptr;
+        {
+            WorkQueue& own = _queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+            }
+        }
+        for (size_t i = 1; task == nullptr && i < _queues.size(); ++i)
+        {
+            WorkQueue& victim = _queues[(self + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+            }
+        }
+        if (task == nullptr) return false;
+        execute(task);
+        return true;
+    }
+
+    void workerLoop(unsigned index)
+    {
+        tlsPool = this;
+        tlsIndex = index;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_stateMutex);
+                _stateCv.wait(lock, [this] { return _running || _stop; });
+                if (_stop) return;
+            }
+            while (_running)
+            {
+                if (!runOne(index)) std::this_thread::yield();
+            }
+        }
+    }
+};
+
+thread_local ForkJoinPool* ForkJoinPool::tlsPool = nullptr;
+thread_local unsigned ForkJoinPool::tlsIndex = 0;
+
+/**
+ * 组合树的并行归约
+ * 节点数不超过grain的子树用显式栈串行遍历，没有递归深度限制；
+ * 较大的子节点派生为任务，其中最大的一个留在当前线程继续向下，避免深而窄的树产生深递归。
+ * value(node)对每个节点求值，combine合并两个结果。各部分的结果按先序位置合并，
+ * 与任务的执行顺序无关，因此combine只需满足结合律。
+ */
+template <typename T, typename Value, typename Combine>
+T serialReduce(DepartmentComponent* root, T identity, Value& value, Combine& combine)
+{
+    T acc = identity;
+    vector<DepartmentComponent*> stack{root};
+    while (!stack.empty())
+    {
+        DepartmentComponent* node = stack.back();
+        stack.pop_back();
+        acc = combine(acc, value(*node));
+        for (size_t i = node->getChildCount(); i > 0; --i)
+        {
+            stack.push_back(node->getChild(i - 1));
+        }
+    }
+    return acc;
+}
+
+template <typename T, typename Value, typename Combine>
+T forkJoinReduce(ForkJoinPool& pool, DepartmentComponent* root, T identity, Value& value, Combine& combine,
+                 size_t grain)
+{
+    struct Context
+    {
+        ForkJoinPool& pool;
+        const T& identity;
+        Value& value;
+        Combine& combine;
+        size_t grain;
+    };
+    // 片段：某个节点的一段连续子节点，或单个大子树。派生时片段本身就是线程池任务
+    struct Part : ForkJoinPool::Task
+    {
+        const Context* context = nullptr;
+        DepartmentComponent* node = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        bool forked = false;
+        T result{};
+    };
+    // 沿最大子树向下的一层：head为节点自身的值，[firstPart, splitPart)在继续向下的子树之前，
+    // [splitPart, endPart)在其之后
+    struct Level
+    {
+        DepartmentComponent* node;
+        size_t nextIndex;
+        T head{};
+        size_t firstPart = 0;
+        size_t splitPart = 0;
+        size_t endPart = 0;
+    };
+    auto reducePart = [](ForkJoinPool::Task& task) {
+        Part& part = static_cast<Part&>(task);
+        const Context& ctx = *part.context;
+        T local = ctx.identity;
+        for (size_t k = part.begin; k < part.end; ++k)
+        {
+            DepartmentComponent* child = part.node->getChild(k);
+            local = ctx.combine(local, child->getNodeCount() > ctx.grain
+                ? forkJoinReduce(ctx.pool, child, ctx.identity, ctx.value, ctx.combine, ctx.grain)
+                : serialReduce(child, ctx.identity, ctx.value, ctx.combine));
+        }
+        part.result = local;
+    };
+
+    // 先确定向下的节点链，片段数不超过链上各节点的子节点数之和，片段数组一次分配且地址不再变化
+    vector<Level> levels;
+    size_t maxParts = 0;
+    for (DepartmentComponent* node = root; node != nullptr;)
+    {
+        size_t nextIndex = node->getChildCount();
+        for (size_t i = 0; i < node->getChildCount(); ++i)
+        {
+            size_t count = node->getChild(i)->getNodeCount();
+            if (count > grain && (nextIndex == node->getChildCount() || count > node->getChild(nextIndex)->getNodeCount()))
+            {
+                nextIndex = i;
+            }
+        }
+        levels.push_back(Level{node, nextIndex});
+        maxParts += node->getChildCount();
+        node = nextIndex < node->getChildCount() ? node->getChild(nextIndex) : nullptr;
+    }
+
+    const Context context{pool, identity, value, combine, grain};
+    vector<Part> parts(maxParts);
+    size_t used = 0;
+    for (Level& level : levels)
+    {
+        DepartmentComponent* node = level.node;
+        level.head = value(*node);
+        level.firstPart = used;
+        level.splitPart = SIZE_MAX;
+        auto emit = [&](size_t begin, size_t end, bool fork) {
+            if (begin == end) return;
+            Part& part = parts[used++];
+            part.context = &context;
+            part.node = node;
+            part.begin = begin;
+            part.end = end;
+            part.run = reducePart;
+            part.forked = fork;
+            if (fork) pool.spawn(part);
+        };
+        // 连续的小子树攒够grain个节点后合成一个任务，浅而宽的树也能分摊到多个线程；
+        // 被大子树打断的批次和末尾不足grain的批次留在当前线程处理
+        size_t batchBegin = 0;
+        size_t batchNodes = 0;
+        for (size_t i = 0; i < node->getChildCount(); ++i)
+        {
+            size_t count = node->getChild(i)->getNodeCount();
+            if (count <= grain)
+            {
+                batchNodes += count;
+                if (batchNodes >= grain)
+                {
+                    emit(batchBegin, i + 1, true);
+                    batchBegin = i + 1;
+                    batchNodes = 0;
+                }
+                continue;
+            }
+            emit(batchBegin, i, false);
+            if (i == level.nextIndex) level.splitPart = used;
+            else emit(i, i + 1, true);
+            batchBegin = i + 1;
+            batchNodes = 0;
+        }
+        emit(batchBegin, node->getChildCount(), false);
+        level.endPart = used;
+        if (level.splitPart == SIZE_MAX) level.splitPart = used;
+        // 本层的任务都已派生，再在当前线程处理未派生的片段
+        for (size_t k = level.firstPart; k < level.endPart; ++k)
+        {
+            if (parts[k].forked) continue;
+            reducePart(parts[k]);
+            parts[k].done.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 按先序合并：自上而下是各层自身的值和继续向下的子树之前的片段，再自下而上是之后的片段
+    T acc = identity;
+    auto take = [&](Part& part) {
+        pool.wait(part);
+        acc = combine(acc, part.result);
+    };
+    for (Level& level : levels)
+    {
+        acc = combine(acc, level.head);
+        for (size_t k = level.firstPart; k < level.splitPart; ++k) take(parts[k]);
+    }
+    for (size_t l = levels.size(); l > 0; --l)
+    {
+        for (size_t k = levels[l - 1].splitPart; k < levels[l - 1].endPart; ++k) take(parts[k]);
+    }
+    return acc;
+}
+
+template <typename T, typename Value, typename Combine>
+T parallelReduce(ForkJoinPool& pool, DepartmentComponent* root, T identity, Value value, Combine combine,
+                 size_t grain = 4096)
+{
+    T result = identity;
+    pool.run([&] { result = forkJoinReduce(pool, root, identity, value, combine, grain); });
+    return result;
+}
+
+// 冷缓存或临时统计时使用的并行薪资汇总
+inline long long parallelCalculateSalary(ForkJoinPool& pool, DepartmentComponent* root)
+{
+    return parallelReduce(pool, root, 0LL,
+        [](DepartmentComponent& node) { return node.isComposite() ? 0LL : node.calculateSalary(); },
+        [](long long a, long long b) { return a + b; });
+}
+
+/**
+ * 冻结的组织树：按先序把所有节点平铺到连续数组中
+ * 节点i的子树占据[i, i + subtreeSize[i])，下一个兄弟节点即为i + subtreeSize[i]；
+ * 名称集中存放在字符串池里，薪资单独成列（部门记0），子树汇总变成一段连续数组的线性扫描。
+ * 适合读多写少的场景，需要修改时可以解冻回指针树。
+ */
+class FrozenOrgTree
+{
+public:
+    explicit FrozenOrgTree(DepartmentComponent* root)
+    {
+        size_t count = root->getNodeCount();
+        _subtreeSize.reserve(count);
+        _salary.reserve(count);
+        _isDepartment.reserve(count);
+        _nameOffset.reserve(count);
+        _nameLength.reserve(count);
+        vector<DepartmentComponent*> stack{root};
+        while (!stack.empty())
+        {
+            DepartmentComponent* node = stack.back();
+            stack.pop_back();
+            _subtreeSize.push_back(static_cast<uint32_t>(node->getNodeCount()));
+            _isDepartment.push_back(node->isComposite() ? 1 : 0);
+            _salary.push_back(node->isComposite() ? 0 : static_cast<int32_t>(node->calculateSalary()));
+            _nameOffset.push_back(static_cast<uint32_t>(_namePool.size()));
+            _nameLength.push_back(static_cast<uint32_t>(node->getName().size()));
+            _namePool += node->getName();
+            for (size_t i = node->getChildCount(); i > 0; --i)
+            {
+                stack.push_back(node->getChild(i - 1));
+            }
+        }
+        _namePool.shrink_to_fit();
+    }
+
+    size_t size() const { return _subtreeSize.size(); }
+    size_t subtreeSize(size_t node) const { return _subtreeSize[node]; }
+    size_t nextSibling(size_t node) const { return node + _subtreeSize[node]; }
+    bool isDepartment(size_t node) const { return _isDepartment[node] != 0; }
+    int salary(size_t node) const { return _salary[node]; }
+    std::string_view name(size_t node) const
+    {
+        return std::string_view(_namePool.data() + _nameOffset[node], _nameLength[node]);
+    }
+
+    long long totalSalary(size_t node = 0) const
+    {
+        long long total = 0;
+        for (size_t i = node, end = nextSibling(node); i < end; ++i) total += _salary[i];
+        return total;
+    }
+
+    size_t memoryBytes() const
+    {
+        return _subtreeSize.capacity() * sizeof(uint32_t) + _salary.capacity() * sizeof(int32_t) +
+               _isDepartment.capacity() + _nameOffset.capacity() * sizeof(uint32_t) +
+               _nameLength.capacity() * sizeof(uint32_t) + _namePool.capacity();
+    }
+
+    // 解冻为指针树，栈中记录每个部门子树的结束位置
+    unique_ptr<DepartmentComponent> thaw() const
+    {
+        if (size() == 0) return nullptr;
+        auto root = makeNode(0);
+        vector<pair<DepartmentComponent*, size_t>> stack;
+        if (isDepartment(0)) stack.emplace_back(root.get(), nextSibling(0));
+        for (size_t i = 1; i < size(); ++i)
+        {
+            while (stack.back().second <= i) stack.pop_back();
+            auto node = makeNode(i);
+            DepartmentComponent* raw = node.get();
+            stack.back().first->add(move(node));
+            if (isDepartment(i)) stack.emplace_back(raw, nextSibling(i));
+        }
+        return root;
+    }
+
+private:
+    vector<uint32_t> _subtreeSize;
+    vector<int32_t> _salary;
+    vector<uint8_t> _isDepartment;
+    vector<uint32_t> _nameOffset;
+    vector<uint32_t> _nameLength;
+    string _namePool;
+
+    unique_ptr<DepartmentComponent> makeNode(size_t node) const
+    {
+        if (isDepartment(node)) return make_unique<Department>(string(name(node)));
+        return make_unique<Employee>(string(name(node)), salary(node));
+    }
+};
+
+// 估算指针树的内存占用：对象本身、子节点指针数组、超出短字符串优化的名称，以及每次分配的管理开销
+static size_t estimatePointerTreeBytes(DepartmentComponent* root)
+{
+    const size_t allocOverhead = 16;
+    size_t bytes = 0;
+    vector<DepartmentComponent*> stack{root};
+    while (!stack.empty())
+    {
+        DepartmentComponent* node = stack.back();
+        stack.pop_back();
+        bytes += (node->isComposite() ? sizeof(Department) : sizeof(Employee)) + allocOverhead;
+        if (node->getName().capacity() > 15) bytes += node->getName().capacity() + 1 + allocOverhead;
+        if (node->getChildCount() > 0)
+        {
+            bytes += node->getChildCount() * sizeof(unique_ptr<DepartmentComponent>) + allocOverhead;
+        }
+        for (size_t i = 0; i < node->getChildCount(); ++i) stack.push_back(node->getChild(i));
+    }
+    return bytes;
+}
+
+/**
+ * 组织树的流式输出
+ * 用显式栈做迭代遍历，没有递归深度限制；所有内容先写入可复用的大缓冲区，写满才整体输出，
+ * 缩进直接从静态的'-'数组中拷贝。输出格式通过OrgFormat扩展，内置文本、JSON和CSV三种。
+ */
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(std::ostream& os, size_t capacity = 1 << 20) : _os(os), _buffer(capacity) {}
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void append(std::string_view str)
+    {
+        if (_used + str.size() > _buffer.size())
+        {
+            flush();
+            if (str.size() > _buffer.size())
+            {
+                _os.write(str.data(), static_cast<std::streamsize>(str.size()));
+                return;
+            }
+        }
+        std::copy(str.begin(), str.end(), _buffer.data() + _used);
+        _used += str.size();
+    }
+
+    void append(char ch)
+    {
+        if (_used == _buffer.size()) flush();
+        _buffer[_used++] = ch;
+    }
+
+    void appendInt(long long value)
+    {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), value);
+        append(std::string_view(digits, res.ptr - digits));
+    }
+
+    // 缩进从静态缓冲区拷贝，不再为每一行构造临时字符串
+    void appendDashes(size_t count)
+    {
+        static const string dashes(256, '-');
+        while (count > 0)
+        {
+            size_t n = std::min(count, dashes.size());
+            append(std::string_view(dashes.data(), n));
+            count -= n;
+        }
+    }
+
+    void flush()
+    {
+        _os.write(_buffer.data(), static_cast<std::streamsize>(_used));
+        _used = 0;
+    }
+
+private:
+    std::ostream& _os;
+    vector<char> _buffer;
+    size_t _used = 0;
+};
+
+class OrgFormat
+{
+public:
+    virtual ~OrgFormat() = default;
+    virtual void begin(OutputBuffer& /*out*/) {}
+    virtual void enter(DepartmentComponent& node, size_t depth, OutputBuffer& out) = 0;
+    virtual void leave(DepartmentComponent& /*node*/, size_t /*depth*/, OutputBuffer& /*out*/) {}
+    virtual void end(OutputBuffer& /*out*/) {}
 };
 
-class Employee : public DepartmentComponent
+// 与display()的输出保持一致
+class TextFormat : public OrgFormat
 {
 public:
-    Employee(string name, int salary) : _name(name), _salary(salary) {}
-    int calculateSalary() override
+    void enter(DepartmentComponent& node, size_t depth, OutputBuffer& out) override
     {
-        return _salary;
+        out.appendDashes(depth * 2 + 1);
+        out.append(node.isComposite() ? " " : " 员工");
+        out.append(node.getName());
+        out.append('\n');
     }
-    void display(int depth) override
+};
+
+class JsonFormat : public OrgFormat
+{
+public:
+    void begin(OutputBuffer& /*out*/) override { _hasSibling.assign(1, false); }
+    void enter(DepartmentComponent& node, size_t /*depth*/, OutputBuffer& out) override
     {
-        cout << string(depth * 2 + 1, '-') << " 员工" << _name << endl;
+        if (_hasSibling.back()) out.append(',');
+        _hasSibling.back() = true;
+        out.append("{\"name\":\"");
+        appendEscaped(node.getName(), out);
+        out.append(node.isComposite() ? "\",\"type\":\"department\",\"salary\":" : "\",\"type\":\"employee\",\"salary\":");
+        out.appendInt(node.calculateSalary());
+        if (node.isComposite())
+        {
+            out.append(",\"children\":[");
+            _hasSibling.push_back(false);
+        }
+        else
+        {
+            out.append('}');
+        }
+    }
+    void leave(DepartmentComponent& node, size_t /*depth*/, OutputBuffer& out) override
+    {
+        if (!node.isComposite()) return;
+        _hasSibling.pop_back();
+        out.append("]}");
     }
+    void end(OutputBuffer& out) override { out.append('\n'); }
 
 private:
-    string _name;
-    int _salary;
+    vector<bool> _hasSibling; // 每一层是否已经输出过兄弟节点，用于决定逗号
+
+    static void appendEscaped(const string& str, OutputBuffer& out)
+    {
+        for (char ch : str)
+        {
+            switch (ch)
+            {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20)
+                {
+                    static const char hex[] = "0123456789abcdef";
+                    out.append("\\u00");
+                    out.append(hex[(ch >> 4) & 0xF]);
+                    out.append(hex[ch & 0xF]);
+                }
+                else
+                {
+                    out.append(ch);
+                }
+            }
+        }
+    }
 };
 
-class Department : public DepartmentComponent
+// 每个节点一行：depth,type,name,salary，部门的salary为子树总额
+class CsvFormat : public OrgFormat
 {
 public:
-    Department(string name) : _name(name) {}
-    int calculateSalary() override
+    void begin(OutputBuffer& out) override { out.append("depth,type,name,salary\n"); }
+    void enter(DepartmentComponent& node, size_t depth, OutputBuffer& out) override
     {
-        int totalSalary = 0;
-        for (const auto& child : _children)
+        out.appendInt(static_cast<long long>(depth));
+        out.append(node.isComposite() ? ",department," : ",employee,");
+        const string& name = node.getName();
+        if (name.find_first_of(",\"\n") == string::npos)
         {
-            totalSalary += child->calculateSalary();
+            out.append(name);
         }
-        return totalSalary;
+        else
+        {
+            out.append('"');
+            for (char ch : name)
+            {
+                if (ch == '"') out.append('"');
+                out.append(ch);
+            }
+            out.append('"');
+        }
+        out.append(',');
+        out.appendInt(node.calculateSalary());
+        out.append('\n');
     }
-    void display(int depth) override
+};
+
+inline void renderOrgTree(DepartmentComponent* root, OrgFormat& format, std::ostream& os)
+{
+    struct Frame
     {
-        std::cout << std::string(depth * 2 + 1, '-') << " " << _name << std::endl;
-        for (const auto& child : _children)
+        DepartmentComponent* node;
+        size_t nextChild;
+    };
+    OutputBuffer out(os);
+    format.begin(out);
+    vector<Frame> stack;
+    format.enter(*root, 0, out);
+    stack.push_back(Frame{root, 0});
+    while (!stack.empty())
+    {
+        Frame& frame = stack.back();
+        if (frame.nextChild < frame.node->getChildCount())
         {
-            child->display(depth+1);
+            DepartmentComponent* child = frame.node->getChild(frame.nextChild++);
+            format.enter(*child, stack.size(), out);
+            stack.push_back(Frame{child, 0});
+        }
+        else
+        {
+            format.leave(*frame.node, stack.size() - 1, out);
+            stack.pop_back();
         }
     }
-    void add(std::unique_ptr<DepartmentComponent> component) override
+    format.end(out);
+    out.flush();
+    os.flush();
+}
+
+/**
+ * 写时复制的持久化组织树
+ * 节点一旦发布就不再修改；写操作只复制从根到目标节点这一条路径，其余子树与旧版本共享，
+ * 最后原子地替换根指针。读线程原子地取得某个版本的根，之后的读取不加任何锁，
+ * 旧版本在最后一个持有它的读者释放后由shared_ptr自动回收。
+ * 写操作之间用互斥锁串行化，不影响读者。
+ */
+struct OrgNode
+{
+    string name;
+    bool isDepartment = false;
+    int salary = 0;           // 员工薪资，部门为0
+    long long totalSalary = 0; // 子树薪资总额
+    size_t nodeCount = 1;
+    vector<shared_ptr<const OrgNode>> children;
+};
+
+using OrgNodePtr = shared_ptr<const OrgNode>;
+
+inline OrgNodePtr makeEmployeeNode(const string& name, int salary)
+{
+    auto node = make_shared<OrgNode>();
+    node->name = name;
+    node->salary = salary;
+    node->totalSalary = salary;
+    return node;
+}
+
+inline OrgNodePtr makeDepartmentNode(const string& name)
+{
+    auto node = make_shared<OrgNode>();
+    node->name = name;
+    node->isDepartment = true;
+    return node;
+}
+
+/**
+ * 当前版本通过原子裸指针发布，读者不取任何锁。
+ * 旧版本的回收使用按奇偶分代的读者计数：读者进入时在当前代的计数上加一，
+ * 复制出shared_ptr后立即减一；写者换上新版本后推进代数，等上一代的计数归零再释放旧指针。
+ * 读者只在进入的瞬间恰好遇到代数推进时重试，从不等待写者；计数按线程分散到多个缓存行上。
+ * 快照本身由shared_ptr持有，读者用完之前对应的节点不会被释放。
+ */
+class OrgSnapshotStore
+{
+public:
+    explicit OrgSnapshotStore(DepartmentComponent& root) : _current(new OrgNodePtr(convert(root))) {}
+
+    ~OrgSnapshotStore()
     {
-        _children.push_back(move(component));
+        delete _current.load();
     }
-    void remove(DepartmentComponent* component) override 
+
+    OrgSnapshotStore(const OrgSnapshotStore&) = delete;
+    OrgSnapshotStore& operator=(const OrgSnapshotStore&) = delete;
+
+    // 读者获取不可变的快照，持有期间该版本不会被回收
+    OrgNodePtr snapshot() const
     {
-        auto it = std::remove_if(_children.begin(), _children.end(),
-            [component](const std::unique_ptr<DepartmentComponent>& ptr) {
-                return ptr.get() == component;
-            });
-        _children.erase(it, _children.end());
+        size_t stripe = readerStripe();
+        ReaderCount* reader;
+        for (;;)
+        {
+            size_t epoch = _epoch.load();
+            reader = &_readers[epoch & 1][stripe];
+            reader->count.fetch_add(1);
+            if (_epoch.load() == epoch) break;
+            reader->count.fetch_sub(1);
+        }
+        OrgNodePtr root = *_current.load();
+        reader->count.fetch_sub(1);
+        return root;
+    }
+
+    // path为从根开始逐层的子节点下标，指向要修改的部门。
+    // 路径无效、目标类型不符或下标越界时返回false，不产生新版本
+    bool addChild(const vector<size_t>& path, OrgNodePtr child)
+    {
+        if (!child) return false;
+        return update(path, [](const OrgNode& dep) { return dep.isDepartment; },
+                      [&child](OrgNode& dep) {
+                          dep.totalSalary += child->totalSalary;
+                          dep.nodeCount += child->nodeCount;
+                          dep.children.push_back(child);
+                      });
+    }
+
+    bool removeChild(const vector<size_t>& path, size_t index)
+    {
+        return update(path, [index](const OrgNode& dep) { return dep.isDepartment && index < dep.children.size(); },
+                      [index](OrgNode& dep) {
+                          dep.totalSalary -= dep.children[index]->totalSalary;
+                          dep.nodeCount -= dep.children[index]->nodeCount;
+                          dep.children.erase(dep.children.begin() + static_cast<std::ptrdiff_t>(index));
+                      });
     }
+
+    // path指向员工节点
+    bool setSalary(const vector<size_t>& path, int salary)
+    {
+        return update(path, [](const OrgNode& node) { return !node.isDepartment; },
+                      [salary](OrgNode& employee) {
+                          employee.totalSalary = salary;
+                          employee.salary = salary;
+                      });
+    }
+
+    size_t version() const { return _version.load(); }
+
 private:
-    string _name;
-    vector<std::unique_ptr<DepartmentComponent>> _children;
+    static constexpr size_t ReaderStripes = 16;
+
+    struct alignas(64) ReaderCount
+    {
+        std::atomic<size_t> count{0};
+    };
+
+    std::atomic<const OrgNodePtr*> _current;
+    std::atomic<size_t> _epoch{0};
+    mutable std::array<std::array<ReaderCount, ReaderStripes>, 2> _readers;
+    std::mutex _writeMutex;
+    std::atomic<size_t> _version{0};
+
+    static size_t readerStripe()
+    {
+        thread_local const size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % ReaderStripes;
+        return stripe;
+    }
+
+    // 只由持有_writeMutex的写者调用：换上新版本，等上一代读者离开后释放旧版本
+    void publish(OrgNodePtr root)
+    {
+        const OrgNodePtr* old = _current.exchange(new OrgNodePtr(move(root)));
+        size_t epoch = _epoch.fetch_add(1);
+        for (const ReaderCount& reader : _readers[epoch & 1])
+        {
+            while (reader.count.load() != 0) std::this_thread::yield();
+        }
+        delete old;
+    }
+
+    static OrgNodePtr convert(DepartmentComponent& component)
+    {
+        if (!component.isComposite())
+        {
+            return makeEmployeeNode(component.getName(), static_cast<int>(component.calculateSalary()));
+        }
+        auto node = make_shared<OrgNode>();
+        node->name = component.getName();
+        node->isDepartment = true;
+        node->children.reserve(component.getChildCount());
+        for (size_t i = 0; i < component.getChildCount(); ++i)
+        {
+            OrgNodePtr child = convert(*component.getChild(i));
+            node->totalSalary += child->totalSalary;
+            node->nodeCount += child->nodeCount;
+            node->children.push_back(move(child));
+        }
+        return node;
+    }
+
+    // 先沿路径找到目标并用valid检查，通过后才复制路径上的每个节点，
+    // 在副本上修改目标节点，再自底向上修正祖先的汇总值
+    template <typename Valid, typename Modify>
+    bool update(const vector<size_t>& path, Valid valid, Modify modify)
+    {
+        std::lock_guard<std::mutex> lock(_writeMutex);
+        OrgNodePtr current = *_current.load();
+        vector<OrgNodePtr> original{current};
+        for (size_t index : path)
+        {
+            if (index >= original.back()->children.size()) return false;
+            original.push_back(original.back()->children[index]);
+        }
+        if (!valid(*original.back())) return false;
+        auto target = make_shared<OrgNode>(*original.back());
+        modify(*target);
+        OrgNodePtr replaced = target;
+        for (size_t level = path.size(); level > 0; --level)
+        {
+            const OrgNode& oldChild = *original[level];
+            auto parent = make_shared<OrgNode>(*original[level - 1]);
+            parent->totalSalary += replaced->totalSalary - oldChild.totalSalary;
+            parent->nodeCount = parent->nodeCount + replaced->nodeCount - oldChild.nodeCount;
+            parent->children[path[level - 1]] = replaced;
+            replaced = parent;
+        }
+        publish(move(replaced));
+        ++_version;
+        return true;
+    }
+};
+
+// 对照：用读写锁保护可变的指针树
+class RwLockedOrgTree
+{
+public:
+    explicit RwLockedOrgTree(unique_ptr<DepartmentComponent> root) : _root(move(root)) {}
+
+    template <typename Fn>
+    auto read(Fn fn) const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        return fn(*_root);
+    }
+
+    template <typename Fn>
+    void write(Fn fn)
+    {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        fn(*_root);
+    }
+
+private:
+    unique_ptr<DepartmentComponent> _root;
+    mutable std::shared_mutex _mutex;
 };
 
-int main()
+// 生成测试用的组织树：每个部门有fanout个子部门，叶子部门下挂员工
+struct OrgTree
 {
+    unique_ptr<DepartmentComponent> root;
+    vector<Department*> departments;
+    vector<Employee*> employees;
+};
+
+static void buildLevel(Department* dep, int depth, int fanout, int employeesPerLeaf, OrgTree& tree)
+{
+    tree.departments.push_back(dep);
+    if (depth == 0)
+    {
+        for (int i = 0; i < employeesPerLeaf; ++i)
+        {
+            auto employee = make_unique<Employee>("员工" + to_string(tree.employees.size()),
+                                                  5000 + static_cast<int>(tree.employees.size() % 10000));
+            tree.employees.push_back(employee.get());
+            dep->add(move(employee));
+        }
+        return;
+    }
+    for (int i = 0; i < fanout; ++i)
+    {
+        auto child = make_unique<Department>("部门" + to_string(tree.departments.size()));
+        Department* raw = child.get();
+        dep->add(move(child));
+        buildLevel(raw, depth - 1, fanout, employeesPerLeaf, tree);
+    }
+}
+
+static OrgTree buildOrgTree(int depth, int fanout, int employeesPerLeaf)
+{
+    OrgTree tree;
+    auto root = make_unique<Department>("总公司");
+    Department* raw = root.get();
+    tree.root = move(root);
+    buildLevel(raw, depth, fanout, employeesPerLeaf, tree);
+    return tree;
+}
+
+// 性能测试：查询与调薪混合负载下，缓存总额与递归计算的对比，并校验结果一致
+static void benchmarkSalaryCache(int depth, int fanout, int employeesPerLeaf)
+{
+    using Clock = std::chrono::steady_clock;
+    OrgTree tree = buildOrgTree(depth, fanout, employeesPerLeaf);
+    std::mt19937 rng(42);
+    const int operations = 20000;
+    const int updateEvery = 10; // 10%调薪，90%查询
+
+    long long checksum = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < operations; ++i)
+    {
+        if (i % updateEvery == 0)
+        {
+            Employee* employee = tree.employees[rng() % tree.employees.size()];
+            employee->setSalary(5000 + static_cast<int>(rng() % 10000));
+        }
+        else
+        {
+            checksum += tree.departments[rng() % tree.departments.size()]->calculateSalary();
+        }
+    }
+    double cachedMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+    // 递归版本只跑少量操作，按比例换算
+    const int recursiveOps = 200;
+    auto t1 = Clock::now();
+    for (int i = 0; i < recursiveOps; ++i)
+    {
+        checksum += tree.root->recalculateSalary();
+    }
+    double recursiveMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+
+    bool consistent = true;
+    for (Department* dep : tree.departments)
+    {
+        if (dep->calculateSalary() != dep->recalculateSalary()) consistent = false;
+    }
+    std::cout << "employees=" << tree.employees.size() << " departments=" << tree.departments.size()
+              << " cached: " << operations / (cachedMs / 1000) << " ops/s"
+              << ", recursive root query: " << recursiveOps / (recursiveMs / 1000) << " ops/s"
+              << ", consistent=" << (consistent ? "yes" : "NO") << " (checksum " << checksum % 1000 << ")" << std::endl;
+}
+
+// 性能测试：深而窄、浅而宽两种形状的百万节点组织树上，并行归约从1个线程扩展到N个线程
+static void benchmarkParallelTraversal()
+{
+    using Clock = std::chrono::steady_clock;
+    struct Shape { const char* name; int depth; int fanout; int employeesPerLeaf; };
+    const Shape shapes[] = {
+        {"deep/narrow", 17, 2, 8},     // 约105万员工
+        {"shallow/wide", 1, 1000, 1000} // 100万员工
+    };
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (const Shape& shape : shapes)
+    {
+        OrgTree tree = buildOrgTree(shape.depth, shape.fanout, shape.employeesPerLeaf);
+        auto t0 = Clock::now();
+        long long expected = tree.root->recalculateSalary();
+        double serialMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        std::cout << shape.name << ": nodes=" << tree.root->getNodeCount()
+                  << " recursive=" << serialMs << "ms" << std::endl;
+        for (unsigned threads = 1; ; threads = std::min(threads * 2, maxThreads))
+        {
+            ForkJoinPool pool(threads);
+            auto t1 = Clock::now();
+            long long total = parallelCalculateSalary(pool, tree.root.get());
+            double salaryMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+            // 自定义归约：统计最高薪资
+            auto t2 = Clock::now();
+            long long maxSalary = parallelReduce(pool, tree.root.get(), 0LL,
+                [](DepartmentComponent& node) { return node.isComposite() ? 0LL : node.calculateSalary(); },
+                [](long long a, long long b) { return std::max(a, b); });
+            double maxMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count();
+            std::cout << "  threads=" << threads << " salary=" << salaryMs << "ms"
+                      << (total == expected ? "" : " (MISMATCH)")
+                      << ", max salary=" << maxMs << "ms (" << maxSalary << ")" << std::endl;
+            if (threads == maxThreads) break;
+        }
+    }
+}
+
+// 性能测试：冻结数组与指针树的内存占用和遍历耗时对比
+static void benchmarkFrozenTree()
+{
+    using Clock = std::chrono::steady_clock;
+    OrgTree tree = buildOrgTree(3, 10, 1000); // 100万员工
+    auto t0 = Clock::now();
+    FrozenOrgTree frozen(tree.root.get());
+    double freezeMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+    const int rounds = 10;
+    long long pointerTotal = 0, frozenTotal = 0;
+    auto t1 = Clock::now();
+    for (int i = 0; i < rounds; ++i) pointerTotal += tree.root->recalculateSalary();
+    double pointerMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count() / rounds;
+    auto t2 = Clock::now();
+    for (int i = 0; i < rounds; ++i) frozenTotal += frozen.totalSalary();
+    double frozenMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count() / rounds;
+
+    auto t3 = Clock::now();
+    unique_ptr<DepartmentComponent> thawed = frozen.thaw();
+    double thawMs = std::chrono::duration<double, std::milli>(Clock::now() - t3).count();
+
+    std::cout << "nodes=" << frozen.size()
+              << " pointer tree ~" << estimatePointerTreeBytes(tree.root.get()) / 1024 << "KB"
+              << ", frozen " << frozen.memoryBytes() / 1024 << "KB" << std::endl;
+    std::cout << "  total salary: pointer walk=" << pointerMs << "ms, frozen scan=" << frozenMs << "ms"
+              << (pointerTotal == frozenTotal ? "" : " (MISMATCH)") << std::endl;
+    std::cout << "  freeze=" << freezeMs << "ms, thaw=" << thawMs << "ms"
+              << (thawed->calculateSalary() == tree.root->calculateSalary() ? "" : " (THAW MISMATCH)") << std::endl;
+}
+
+// 性能测试：批量调岗，句柄O(1)定位与逐个线性查找子节点的对比
+static void benchmarkReorganization()
+{
+    using Clock = std::chrono::steady_clock;
+    const int departmentCount = 100;
+    const int employeesPerDepartment = 1000;
+    auto build = [&](OrgChart& chart, vector<NodeHandle>& deps, vector<NodeHandle>& employees) {
+        for (int d = 0; d < departmentCount; ++d)
+        {
+            NodeHandle dep = chart.add(chart.rootHandle(), make_unique<Department>("部门" + to_string(d)));
+            deps.push_back(dep);
+            for (int e = 0; e < employeesPerDepartment; ++e)
+            {
+                employees.push_back(chart.add(dep, make_unique<Employee>("员工" + to_string(e), 5000 + e)));
+            }
+        }
+    };
+    const size_t moves = 100000;
+
+    OrgChart chart(make_unique<Department>("总公司"));
+    vector<NodeHandle> deps, employees;
+    build(chart, deps, employees);
+    std::mt19937 rng(42);
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < moves; ++i)
+    {
+        chart.transfer(employees[rng() % employees.size()], deps[rng() % deps.size()]);
+    }
+    double handleMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+    // 对照：与原先remove一样，按指针在父部门的子节点中线性查找
+    OrgChart linear(make_unique<Department>("总公司"));
+    vector<NodeHandle> deps2, employees2;
+    build(linear, deps2, employees2);
+    rng.seed(42);
+    size_t scanned = 0;
+    auto t1 = Clock::now();
+    for (size_t i = 0; i < moves; ++i)
+    {
+        DepartmentComponent* node = linear.get(employees2[rng() % employees2.size()]);
+        Department* target = static_cast<Department*>(linear.get(deps2[rng() % deps2.size()]));
+        Department* parent = node->getParent();
+        size_t k = 0;
+        while (parent->getChild(k) != node) ++k;
+        scanned += k;
+        // 与transfer一样按树内调岗处理，句柄保持有效
+        target->attach(parent->detach(parent->getChild(k), false), false);
+    }
+    double linearMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+
+    bool consistent = chart.getRoot()->calculateSalary() == chart.getRoot()->recalculateSalary();
+    std::cout << "employees=" << employees.size() << " moves=" << moves
+              << " handle move=" << handleMs << "ms"
+              << ", linear lookup=" << linearMs << "ms (avg scanned " << scanned / moves << " children)"
+              << ", totals consistent=" << (consistent ? "yes" : "NO") << std::endl;
+}
+
+// 性能测试：百万节点组织树输出到/dev/null，逐行display与流式输出的对比
+static void benchmarkRender()
+{
+    using Clock = std::chrono::steady_clock;
+    OrgTree tree = buildOrgTree(3, 10, 1000);
+    std::ofstream devNull("/dev/null");
+    auto t0 = Clock::now();
+    std::streambuf* coutBuf = std::cout.rdbuf(devNull.rdbuf());
+    tree.root->display();
+    std::cout.rdbuf(coutBuf);
+    double displayMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    std::cout << "nodes=" << tree.root->getNodeCount() << " display()=" << displayMs << "ms";
+
+    TextFormat text;
+    JsonFormat json;
+    CsvFormat csv;
+    const pair<const char*, OrgFormat*> formats[] = {{"text", &text}, {"json", &json}, {"csv", &csv}};
+    for (const auto& item : formats)
+    {
+        auto t1 = Clock::now();
+        renderOrgTree(tree.root.get(), *item.second, devNull);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+        std::cout << ", " << item.first << "=" << ms << "ms";
+    }
+    std::cout << std::endl;
+}
+
+// 性能测试：10万与100万节点上，索引查询与全树遍历的对比
+static void benchmarkIndex()
+{
+    using Clock = std::chrono::steady_clock;
+    for (int employeesPerLeaf : {100, 1000})
+    {
+        OrgTree tree = buildOrgTree(3, 10, employeesPerLeaf);
+        Department& root = static_cast<Department&>(*tree.root);
+        auto t0 = Clock::now();
+        OrgIndex index(root);
+        double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        std::mt19937 rng(42);
+        const int queries = 1000;
+        size_t found = 0;
+        auto t1 = Clock::now();
+        for (int i = 0; i < queries; ++i)
+        {
+            found += index.findByName(tree.employees[rng() % tree.employees.size()]->getName()).size();
+        }
+        double nameMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count() / queries;
+        auto t2 = Clock::now();
+        for (int i = 0; i < queries; ++i)
+        {
+            int low = 5000 + static_cast<int>(rng() % 9990);
+            found += index.findBySalary(low, low + 10).size();
+        }
+        double salaryMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count() / queries;
+
+        // 对照：全树遍历
+        const int scans = 5;
+        auto t3 = Clock::now();
+        for (int i = 0; i < scans; ++i)
+        {
+            const string& target = tree.employees[rng() % tree.employees.size()]->getName();
+            auto matches = [&target](DepartmentComponent& node) {
+                return node.isComposite() || node.getName() != target ? 0LL : 1LL;
+            };
+            auto sum = [](long long a, long long b) { return a + b; };
+            found += serialReduce(tree.root.get(), 0LL, matches, sum);
+        }
+        double scanMs = std::chrono::duration<double, std::milli>(Clock::now() - t3).count() / scans;
+
+        // 调薪时索引的维护开销
+        auto t4 = Clock::now();
+        for (int i = 0; i < queries; ++i)
+        {
+            tree.employees[rng() % tree.employees.size()]->setSalary(5000 + static_cast<int>(rng() % 10000));
+        }
+        double updateUs = std::chrono::duration<double, std::micro>(Clock::now() - t4).count() / queries;
+
+        std::cout << "nodes=" << tree.root->getNodeCount() << " build=" << buildMs << "ms"
+                  << ", name lookup=" << nameMs * 1000 << "us, salary range=" << salaryMs * 1000 << "us"
+                  << ", full traversal=" << scanMs << "ms, salary update=" << updateUs << "us"
+                  << " (found " << found << ")" << std::endl;
+    }
+}
+
+// 压力测试：多个读线程与一个写线程并发，比较写时复制快照与读写锁的吞吐
+// 读者沿随机路径下行，校验每一层的汇总值等于子节点之和，快照不一致即视为错误
+static void benchmarkSnapshots()
+{
+    using Clock = std::chrono::steady_clock;
+    const auto duration = std::chrono::milliseconds(1000);
+    unsigned readers = std::max(2u, std::thread::hardware_concurrency());
+
+    {
+        OrgTree tree = buildOrgTree(3, 10, 100);
+        OrgSnapshotStore store(*tree.root);
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> reads{0}, errors{0};
+        vector<std::thread> threads;
+        for (unsigned r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&, r] {
+                std::mt19937 rng(r);
+                size_t local = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    OrgNodePtr snap = store.snapshot();
+                    const OrgNode* node = snap.get();
+                    while (node->isDepartment && !node->children.empty())
+                    {
+                        long long sum = 0;
+                        for (const auto& child : node->children) sum += child->totalSalary;
+                        if (sum != node->totalSalary) errors.fetch_add(1);
+                        node = node->children[rng() % node->children.size()].get();
+                    }
+                    ++local;
+                }
+                reads += local;
+            });
+        }
+        size_t writes = 0;
+        std::mt19937 rng(99);
+        auto start = Clock::now();
+        while (Clock::now() - start < duration)
+        {
+            vector<size_t> path{rng() % 10, rng() % 10, rng() % 10};
+            if (writes % 2 == 0)
+            {
+                store.addChild(path, makeEmployeeNode("新员工", 5000 + static_cast<int>(rng() % 1000)));
+            }
+            else
+            {
+                store.removeChild(path, 0);
+            }
+            ++writes;
+        }
+        stop = true;
+        for (auto& th : threads) th.join();
+        std::cout << "copy-on-write: readers=" << readers << " reads/s=" << reads.load()
+                  << " writes/s=" << writes << " versions=" << store.version()
+                  << " inconsistent snapshots=" << errors.load() << std::endl;
+    }
+
+    {
+        OrgTree tree = buildOrgTree(3, 10, 100);
+        vector<Department*> leafDepartments;
+        for (Department* dep : tree.departments)
+        {
+            if (dep->getChildCount() > 0 && !dep->getChild(0)->isComposite()) leafDepartments.push_back(dep);
+        }
+        RwLockedOrgTree locked(move(tree.root));
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> reads{0}, errors{0};
+        vector<std::thread> threads;
+        for (unsigned r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&, r] {
+                std::mt19937 rng(r);
+                size_t local = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    errors += locked.read([&rng](DepartmentComponent& root) {
+                        size_t bad = 0;
+                        DepartmentComponent* node = &root;
+                        while (node->isComposite() && node->getChildCount() > 0)
+                        {
+                            long long sum = 0;
+                            for (size_t i = 0; i < node->getChildCount(); ++i) sum += node->getChild(i)->calculateSalary();
+                            if (sum != node->calculateSalary()) ++bad;
+                            node = node->getChild(rng() % node->getChildCount());
+                        }
+                        return bad;
+                    });
+                    ++local;
+                }
+                reads += local;
+            });
+        }
+        size_t writes = 0;
+        std::mt19937 rng(99);
+        auto start = Clock::now();
+        while (Clock::now() - start < duration)
+        {
+            Department* dep = leafDepartments[rng() % leafDepartments.size()];
+            locked.write([&](DepartmentComponent&) {
+                if (writes % 2 == 0) dep->add(make_unique<Employee>("新员工", 5000 + static_cast<int>(rng() % 1000)));
+                else dep->remove(dep->getChild(0));
+            });
+            ++writes;
+        }
+        stop = true;
+        for (auto& th : threads) th.join();
+        std::cout << "rw-lock:       readers=" << readers << " reads/s=" << reads.load()
+                  << " writes/s=" << writes << " inconsistent reads=" << errors.load() << std::endl;
+    }
+}
+
+// 运行 ./composite_adjustedAns bench <salary|parallel|frozen|reorg|render|index|snapshot> 进行性能测试，建议使用 -O2 编译
+int main(int argc, char* argv[])
+{
+    if (argc > 2 && string(argv[1]) == "bench")
+    {
+        string name = argv[2];
+        if (name == "salary")
+        {
+            benchmarkSalaryCache(4, 10, 10);   // 10万员工
+            benchmarkSalaryCache(5, 10, 5);    // 50万员工
+        }
+        else if (name == "parallel")
+        {
+            benchmarkParallelTraversal();
+        }
+        else if (name == "frozen")
+        {
+            benchmarkFrozenTree();
+        }
+        else if (name == "reorg")
+        {
+            benchmarkReorganization();
+        }
+        else if (name == "render")
+        {
+            benchmarkRender();
+        }
+        else if (name == "index")
+        {
+            benchmarkIndex();
+        }
+        else if (name == "snapshot")
+        {
+            benchmarkSnapshots();
+        }
+        else
+        {
+            cout << "Unknown benchmark: " << name << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     unique_ptr<DepartmentComponent> auditGroup = make_unique<Department>("子部门审计组");
     auditGroup->add(make_unique<Employee>("赵六", 6000));
     auditGroup->add(make_unique<Employee>("陈七", 6000));
@@ -79,7 +1849,9 @@ int main()
     financialDep->add(make_unique<Employee>("王五", 8000));
     financialDep->add(move(auditGroup));
     unique_ptr<DepartmentComponent> techDep = make_unique<Department>("技术部");
-    techDep->add(make_unique<Employee>("张三", 10000));
+    auto zhangSan = make_unique<Employee>("张三", 10000);
+    Employee* pZhangSan = zhangSan.get();
+    techDep->add(move(zhangSan));
     techDep->add(make_unique<Employee>("李四", 12000));
     unique_ptr<DepartmentComponent> company = make_unique<Department>("总公司");
     company->add(move(techDep));
@@ -87,5 +1859,82 @@ int main()
     company->display();
     cout << "总公司总薪资：" << to_string(company->calculateSalary()) << endl;
 
+    // 调薪后缓存的总额同步更新
+    pZhangSan->setSalary(11000);
+    cout << "张三调薪后总公司总薪资：" << to_string(company->calculateSalary())
+         << "，递归校验：" << to_string(company->recalculateSalary()) << endl;
+
+    // 并行遍历：工作窃取线程池上的汇总与自定义归约
+    ForkJoinPool pool;
+    cout << "并行汇总总薪资：" << to_string(parallelCalculateSalary(pool, company.get())) << endl;
+    long long employeeCount = parallelReduce(pool, company.get(), 0LL,
+        [](DepartmentComponent& node) { return node.isComposite() ? 0LL : 1LL; },
+        [](long long a, long long b) { return a + b; });
+    cout << "员工人数：" << to_string(employeeCount) << endl;
+
+    // 冻结为连续数组后线性扫描，再解冻回指针树
+    FrozenOrgTree frozen(company.get());
+    for (size_t i = 0; i < frozen.size(); ++i)
+    {
+        if (frozen.isDepartment(i))
+        {
+            cout << frozen.name(i) << "：" << to_string(frozen.totalSalary(i)) << endl;
+        }
+    }
+    unique_ptr<DepartmentComponent> thawed = frozen.thaw();
+    thawed->display();
+
+    // 稳定句柄：调岗不拷贝子树，删除后旧句柄失效
+    OrgChart chart(make_unique<Department>("新公司"));
+    NodeHandle rd = chart.add(chart.rootHandle(), make_unique<Department>("研发部"));
+    NodeHandle qa = chart.add(chart.rootHandle(), make_unique<Department>("测试部"));
+    NodeHandle sunBa = chart.add(rd, make_unique<Employee>("孙八", 9000));
+    chart.add(rd, make_unique<Employee>("周九", 9500));
+    chart.transfer(sunBa, qa);
+    cout << "孙八调岗到：" << chart.get(sunBa)->getParent()->getName()
+         << "，测试部薪资：" << to_string(chart.get(qa)->calculateSalary()) << endl;
+    chart.remove(sunBa);
+    cout << "孙八离职后句柄" << (chart.get(sunBa) == nullptr ? "已失效" : "仍有效")
+         << "，新公司总薪资：" << to_string(chart.getRoot()->calculateSalary()) << endl;
+    // 绕过OrgChart直接从部门删除，句柄同样失效
+    NodeHandle zhengShi = chart.add(qa, make_unique<Employee>("郑十", 8000));
+    chart.get(qa)->remove(chart.get(zhengShi));
+    cout << "郑十直接删除后句柄" << (chart.get(zhengShi) == nullptr ? "已失效" : "仍有效") << endl;
+
+    // 流式输出：文本、JSON、CSV
+    TextFormat textFormat;
+    JsonFormat jsonFormat;
+    CsvFormat csvFormat;
+    renderOrgTree(company.get(), textFormat, cout);
+    renderOrgTree(company.get(), jsonFormat, cout);
+    renderOrgTree(company.get(), csvFormat, cout);
+
+    // 二级索引：按姓名和薪资区间查找员工，并给出所在部门的路径
+    {
+        OrgIndex index(static_cast<Department&>(*company));
+        for (const auto& match : index.findByName("王五"))
+        {
+            cout << "按姓名查找：" << OrgIndex::formatPath(match) << endl;
+        }
+        company->add(make_unique<Employee>("吴十", 7000));
+        pZhangSan->setSalary(6500);
+        for (const auto& match : index.findBySalary(6000, 7000))
+        {
+            cout << "薪资6000~7000：" << OrgIndex::formatPath(match) << " " << match.employee->getSalary() << endl;
+        }
+    }
+
+    // 写时复制快照：写入产生新版本，旧快照保持不变
+    OrgSnapshotStore store(*company);
+    OrgNodePtr before = store.snapshot();
+    store.addChild({0}, makeEmployeeNode("郑十一", 9000));
+    OrgNodePtr after = store.snapshot();
+    cout << "快照写入前总薪资：" << to_string(before->totalSalary)
+         << "，写入后：" << to_string(after->totalSalary)
+         << "，财务部子树" << (before->children[1] == after->children[1] ? "共享" : "复制") << endl;
+    bool rejected = !store.setSalary({0}, 1) && !store.removeChild({0}, 99);
+    cout << "对部门设置薪资、越界删除：" << (rejected ? "已拒绝" : "未拒绝")
+         << "，版本号仍为" << store.version() << endl;
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,28 +1,168 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+#include <list>
+#include <unordered_map>
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 流式渲染的输出端，内容按块依次写入
+class ChunkSink {
+public:
+    virtual ~ChunkSink() = default;
+    virtual void write(std::string_view chunk) = 0;
+};
 
 class Text {
 public:
     virtual ~Text() = default;
     virtual std::string render() const = 0; // 添加const限定，定义为常成员函数，确保函数不会修改对象内部状态
+    // 单次分配的渲染协议：先算出总长度，再由各层把内容依次追加到同一个缓冲区
+    // renderedSize()只用于预留容量：只有前后缀的链上是精确值，变换层给出不做变换就能得到的估计
+    // 默认实现退化为调用render()，保证只实现了render()的Text也能接入装饰链
+    virtual size_t renderedSize() const { return render().size(); }
+    virtual void renderTo(std::string& out) const { out += render(); }
+    // 内容版本号：PlainText每次修改时递增，装饰器把下层的版本号原样向上传递
+    virtual uint64_t version() const { return 0; }
+    // 流式渲染：不拼出完整字符串，各层把前缀、下层的内容块和后缀依次写入sink
+    virtual void renderStream(ChunkSink& sink) const { sink.write(render()); }
 };
 
+/**
+ * 渲染路径不加锁：内容以不可变字符串的形式发布，读者只做原子读取
+ * setContent()生成新版本后原子地替换指针。读者访问内容期间登记在当前代的读者计数上，
+ * 写者替换指针后推进代数，等上一代的读者全部离开再释放旧版本，因此内存只保留当前版本。
+ * 读者只在进入的瞬间恰好遇到代数推进时重试，从不等待写者；写者最多等待一次正在进行的字符串拷贝。
+ * renderStream()会调用外部的sink，耗时不可控，因此只在登记期间复制引用计数句柄钉住当前版本，
+ * 离开后再写入sink：慢速sink不会拖住setContent()，sink内部回调setContent()也不会死锁
+ */
 class PlainText final : public Text {
 public:
     explicit PlainText(std::string content) 
-        : content_(std::move(content)) {}
+    {
+        publish(std::move(content));
+    }
+
+    ~PlainText() override {
+        delete content_.load();
+    }
+
+    PlainText(const PlainText&) = delete;
+    PlainText& operator=(const PlainText&) = delete;
 
     std::string render() const override {
-        std::lock_guard<std::mutex> lock(mtx_);
-        return content_;
+        ReadGuard guard(*this);
+        return guard.content();
+    }
+
+    size_t renderedSize() const override {
+        ReadGuard guard(*this);
+        return guard.content().size();
+    }
+
+    // 与renderedSize()之间内容可能被替换，此时只影响预留的容量，输出仍然正确
+    void renderTo(std::string& out) const override {
+        ReadGuard guard(*this);
+        out += guard.content();
+    }
+
+    void setContent(std::string content) {
+        publish(std::move(content));
+    }
+
+    uint64_t version() const override {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    void renderStream(ChunkSink& sink) const override {
+        std::shared_ptr<const std::string> content = pin();
+        sink.write(*content);
     }
 
 private:
-    mutable std::mutex mtx_;  // 保证线程安全
-    std::string content_;
+    static constexpr size_t ReaderStripes = 4;
+
+    struct alignas(64) ReaderCount {
+        std::atomic<size_t> count{0};
+    };
+
+    // 读者在作用域内持有当前版本，析构时离开
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const PlainText& text) {
+            size_t stripe = readerStripe();
+            for (;;) {
+                uint64_t epoch = text.epoch_.load();
+                reader_ = &text.readers_[epoch & 1][stripe];
+                reader_->count.fetch_add(1);
+                if (text.epoch_.load() == epoch) break;
+                reader_->count.fetch_sub(1);
+            }
+            content_ = text.content_.load();
+        }
+        ~ReadGuard() { reader_->count.fetch_sub(1); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        const std::string& content() const { return **content_; }
+        const std::shared_ptr<const std::string>& handle() const { return *content_; }
+
+    private:
+        ReaderCount* reader_;
+        const std::shared_ptr<const std::string>* content_;
+    };
+
+    std::atomic<const std::shared_ptr<const std::string>*> content_{nullptr};
+    std::atomic<uint64_t> version_{0};
+    std::atomic<uint64_t> epoch_{0};
+    mutable ReaderCount readers_[2][ReaderStripes];
+    std::mutex writeMtx_;  // 只在写入之间互斥，渲染不会获取
+
+    static size_t readerStripe() {
+        thread_local const size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % ReaderStripes;
+        return stripe;
+    }
+
+    // 取得当前版本的句柄，持有期间该版本不会被释放，也不阻塞写者
+    std::shared_ptr<const std::string> pin() const {
+        ReadGuard guard(*this);
+        return guard.handle();
+    }
+
+    void publish(std::string content) {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        const std::shared_ptr<const std::string>* old = content_.exchange(
+            new const std::shared_ptr<const std::string>(std::make_shared<const std::string>(std::move(content))));
+        // 先发布内容再递增版本号，读到新版本号的读者一定能读到新内容
+        version_.fetch_add(1, std::memory_order_release);
+        uint64_t epoch = epoch_.fetch_add(1);
+        for (const ReaderCount& reader : readers_[epoch & 1]) {
+            while (reader.count.load() != 0) std::this_thread::yield();
+        }
+        delete old;
+    }
 };
 
+// 装饰器在构造后不再修改，多线程并发render无需加锁
+// 具体装饰器只需提供前缀和后缀，整条链渲染时只分配一次内存，拷贝量与输出长度成线性关系
 class SafeDecorator : public Text {    
 public:
     explicit SafeDecorator(std::unique_ptr<Text> t) // 使用智能指针，解决对象所有权模糊的问题。explicit避免隐式类型转换
@@ -32,8 +172,30 @@ public:
     }
 
     std::string render() const override {
-        std::lock_guard<std::mutex> lock(mtx); // 避免多线程访问render可能出现的问题，当前程序不存在问题
-        return wrapped->render();
+        std::string out;
+        out.reserve(renderedSize());
+        renderTo(out);
+        return out;
+    }
+
+    size_t renderedSize() const override {
+        return prefix().size() + wrapped->renderedSize() + suffix().size();
+    }
+
+    void renderTo(std::string& out) const override {
+        out += prefix();
+        wrapped->renderTo(out);
+        out += suffix();
+    }
+
+    uint64_t version() const override {
+        return wrapped->version();
+    }
+
+    void renderStream(ChunkSink& sink) const override {
+        sink.write(prefix());
+        wrapped->renderStream(sink);
+        sink.write(suffix());
     }
 
     // 禁用拷贝
@@ -45,44 +207,1452 @@ public:
     SafeDecorator& operator=(SafeDecorator&&) = default;
 
 protected:
+    virtual std::string_view prefix() const { return {}; }
+    virtual std::string_view suffix() const { return {}; }
+
     std::unique_ptr<Text> wrapped;
-    mutable std::mutex mtx;
 };
 
 class BoldDecorator : public SafeDecorator
 {
 public:
     BoldDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+
+protected:
+    std::string_view prefix() const override { return "<b>"; }
+    std::string_view suffix() const override { return "</b>"; }
+};
+
+class ItalicDecorator : public SafeDecorator
+{
+public:
+    ItalicDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+
+protected:
+    std::string_view prefix() const override { return "<i>"; }
+    std::string_view suffix() const override { return "</i>"; }
+};
+
+class UnderlineDecorator : public SafeDecorator
+{
+public:
+    UnderlineDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+
+protected:
+    std::string_view prefix() const override { return "<u>"; }
+    std::string_view suffix() const override { return "</u>"; }
+};
+
+/**
+ * 渲染结果缓存
+ * CachedDecorator按需加入装饰链，缓存其下方整棵子链的渲染结果，并记录渲染时的版本号；
+ * 下层内容被修改后版本号变化，只有受影响的链会重新渲染。
+ * 所有缓存项共享一个全局字节预算，超出时按LRU淘汰。
+ */
+class RenderCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    static RenderCache& global()
+    {
+        static RenderCache cache;
+        return cache;
+    }
+
+    void setBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        budget_ = bytes;
+        enforceBudget();
+    }
+
+    // 命中时返回缓存内容并移到LRU表头，版本不符视为未命中
+    std::shared_ptr<const std::string> lookup(const void* owner, uint64_t version)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto searchRes = entries_.find(owner);
+        if (searchRes == entries_.end() || searchRes->second.version != version)
+        {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        lru_.splice(lru_.begin(), lru_, searchRes->second.lruPos);
+        return searchRes->second.value;
+    }
+
+    void store(const void* owner, uint64_t version, std::shared_ptr<const std::string> value)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        eraseLocked(owner);
+        if (value->size() > budget_) return;
+        lru_.push_front(owner);
+        bytes_ += value->size();
+        entries_.emplace(owner, Entry{version, std::move(value), lru_.begin()});
+        enforceBudget();
+    }
+
+    void erase(const void* owner)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        eraseLocked(owner);
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Stats stats = stats_;
+        stats.entries = entries_.size();
+        stats.bytes = bytes_;
+        return stats;
+    }
+
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stats_ = Stats{};
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t version;
+        std::shared_ptr<const std::string> value;
+        std::list<const void*>::iterator lruPos;
+    };
+
+    mutable std::mutex mtx_;
+    std::unordered_map<const void*, Entry> entries_;
+    std::list<const void*> lru_; // 表头为最近使用
+    size_t budget_ = 64 << 20;
+    size_t bytes_ = 0;
+    Stats stats_;
+
+    void eraseLocked(const void* owner)
+    {
+        auto searchRes = entries_.find(owner);
+        if (searchRes == entries_.end()) return;
+        bytes_ -= searchRes->second.value->size();
+        lru_.erase(searchRes->second.lruPos);
+        entries_.erase(searchRes);
+    }
+
+    void enforceBudget()
+    {
+        while (bytes_ > budget_ && !lru_.empty())
+        {
+            eraseLocked(lru_.back());
+            ++stats_.evictions;
+        }
+    }
+};
+
+class CachedDecorator : public SafeDecorator
+{
+public:
+    explicit CachedDecorator(std::unique_ptr<Text> t, RenderCache& cache = RenderCache::global())
+        : SafeDecorator(std::move(t)), cache_(cache) {}
+
+    ~CachedDecorator() override
+    {
+        cache_.erase(this);
+    }
+
     std::string render() const override
     {
-        std::lock_guard<std::mutex> lock(mtx);
-        return "<b>" + wrapped->render() + "</b>";
+        return *cached();
+    }
+
+    // 外层装饰器先调用renderedSize()预留空间再调用renderTo()，
+    // 这里不查缓存，只向下层询问长度，保证一次外层渲染只查一次缓存
+    size_t renderedSize() const override
+    {
+        return wrapped->renderedSize();
+    }
+
+    void renderTo(std::string& out) const override
+    {
+        out += *cached();
     }
+
+    void renderStream(ChunkSink& sink) const override
+    {
+        sink.write(*cached());
+    }
+
+    // 直接共享缓存中的字符串，命中时没有任何拷贝
+    // 先读版本号再渲染：渲染期间内容若被修改，缓存的版本号偏旧，下次会重新渲染
+    std::shared_ptr<const std::string> cached() const
+    {
+        uint64_t current = wrapped->version();
+        std::shared_ptr<const std::string> value = cache_.lookup(this, current);
+        if (value) return value;
+        std::string out;
+        out.reserve(wrapped->renderedSize());
+        wrapped->renderTo(out);
+        value = std::make_shared<const std::string>(std::move(out));
+        cache_.store(this, current, value);
+        return value;
+    }
+
+private:
+    RenderCache& cache_;
 };
 
-class ItalicDecorator : public SafeDecorator
+/**
+ * 编译期组合装饰器
+ * 装饰组合在编译期已知时，用Decorated<PlainText, layer::Italic, layer::Bold>代替逐层make_unique：
+ * 被装饰对象直接作为成员保存，各层只是编译期常量的前后缀，整条链只有一次堆分配，
+ * 内部调用全部静态分派，可被编译器内联。Decorated本身实现Text接口，能继续被运行时装饰器包装；
+ * 以RuntimeText为基础时也能包装已有的运行时装饰链。
+ * 层的顺序与运行时写法一致：越靠后的层越在外面。
+ */
+namespace layer
+{
+struct Bold
+{
+    static constexpr std::string_view open = "<b>";
+    static constexpr std::string_view close = "</b>";
+};
+
+struct Italic
+{
+    static constexpr std::string_view open = "<i>";
+    static constexpr std::string_view close = "</i>";
+};
+
+struct Underline
+{
+    static constexpr std::string_view open = "<u>";
+    static constexpr std::string_view close = "</u>";
+};
+} // namespace layer
+
+// 把运行时的Text适配为Decorated的基础内容
+class RuntimeText final
 {
 public:
-    ItalicDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+    explicit RuntimeText(std::unique_ptr<Text> t) : text_(std::move(t))
+    {
+        if (!text_) throw std::invalid_argument("Invalid wrapped");
+    }
+    size_t renderedSize() const { return text_->renderedSize(); }
+    void renderTo(std::string& out) const { text_->renderTo(out); }
+    uint64_t version() const { return text_->version(); }
+    void renderStream(ChunkSink& sink) const { text_->renderStream(sink); }
+
+private:
+    std::unique_ptr<Text> text_;
+};
+
+template <typename Base, typename... Layers>
+class Decorated final : public Text
+{
+public:
+    template <typename... Args>
+    explicit Decorated(Args&&... args) : base_(std::forward<Args>(args)...) {}
+
     std::string render() const override
     {
-        return "<i>" + wrapped->render() + "</i>";
+        std::string out;
+        out.reserve(renderedSize());
+        renderTo(out);
+        return out;
     }
+
+    size_t renderedSize() const override
+    {
+        return base_.renderedSize() + (size_t(0) + ... + (Layers::open.size() + Layers::close.size()));
+    }
+
+    void renderTo(std::string& out) const override
+    {
+        // 外层的开始标签先输出，因此逆序展开
+        constexpr std::string_view opens[] = {Layers::open..., std::string_view()};
+        for (size_t i = sizeof...(Layers); i > 0; --i) out += opens[i - 1];
+        base_.renderTo(out);
+        (out += ... += Layers::close);
+    }
+
+    uint64_t version() const override
+    {
+        return base_.version();
+    }
+
+    void renderStream(ChunkSink& sink) const override
+    {
+        constexpr std::string_view opens[] = {Layers::open..., std::string_view()};
+        for (size_t i = sizeof...(Layers); i > 0; --i) sink.write(opens[i - 1]);
+        base_.renderStream(sink);
+        (sink.write(Layers::close), ...);
+    }
+
+    Base& base() { return base_; }
+
+private:
+    Base base_;
 };
 
-class UnderlineDecorator : public SafeDecorator
+/**
+ * 文本变换装饰器：HTML转义、空白折叠、大小写转换
+ * 扫描特殊字符的内核有标量、SSE4.2、AVX2三个版本，一次检查16或32个字节，
+ * 运行时按CPU支持的指令集选择，其他平台只编译标量版本。
+ */
+namespace text_kernels
+{
+enum class SimdLevel { Scalar, SSE42, AVX2 };
+
+inline const char* levelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE42: return "sse4.2";
+    default: return "scalar";
+    }
+}
+
+inline bool isEscapeChar(char ch)
+{
+    return ch == '&' || ch == '<' || ch == '>' || ch == '"' || ch == '\'';
+}
+
+inline bool isSpaceChar(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// 以下查找函数都返回第一个满足条件的下标，找不到时返回n
+inline size_t findEscapeScalar(const char* p, size_t n)
+{
+    size_t i = 0;
+    while (i < n && !isEscapeChar(p[i])) ++i;
+    return i;
+}
+
+inline size_t findSpaceScalar(const char* p, size_t n)
+{
+    size_t i = 0;
+    while (i < n && !isSpaceChar(p[i])) ++i;
+    return i;
+}
+
+inline size_t findNonSpaceScalar(const char* p, size_t n)
+{
+    size_t i = 0;
+    while (i < n && isSpaceChar(p[i])) ++i;
+    return i;
+}
+
+inline void changeCaseScalar(char* p, size_t n, bool upper)
+{
+    const char low = upper ? 'a' : 'A';
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (static_cast<unsigned char>(p[i] - low) < 26) p[i] ^= 0x20;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE4.2：PCMPESTRI在16个字节中查找第一个属于（或不属于）字符集合的位置
+__attribute__((target("sse4.2"))) inline size_t findEscapeSse42(const char* p, size_t n)
+{
+    const __m128i set = _mm_setr_epi8('&', '<', '>', '"', '\'', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int index = _mm_cmpestri(set, 5, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+        if (index < 16) return i + static_cast<size_t>(index);
+    }
+    return i + findEscapeScalar(p + i, n - i);
+}
+
+__attribute__((target("sse4.2"))) inline size_t findSpaceSse42(const char* p, size_t n)
+{
+    const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int index = _mm_cmpestri(set, 4, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+        if (index < 16) return i + static_cast<size_t>(index);
+    }
+    return i + findSpaceScalar(p + i, n - i);
+}
+
+__attribute__((target("sse4.2"))) inline size_t findNonSpaceSse42(const char* p, size_t n)
+{
+    const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int index = _mm_cmpestri(set, 4, chunk, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+        if (index < 16) return i + static_cast<size_t>(index);
+    }
+    return i + findNonSpaceScalar(p + i, n - i);
+}
+
+// 大小写：字节减去'a'（或'A'）后按有符号比较落在[-128, -128 + 26)即为需要转换的字母
+__attribute__((target("sse4.2"))) inline void changeCaseSse42(char* p, size_t n, bool upper)
+{
+    const __m128i shift = _mm_set1_epi8(static_cast<char>((upper ? 'a' : 'A') + 128));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i isLetter = _mm_cmplt_epi8(_mm_sub_epi8(chunk, shift), limit);
+        chunk = _mm_xor_si128(chunk, _mm_and_si128(isLetter, flip));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), chunk);
+    }
+    changeCaseScalar(p + i, n - i, upper);
+}
+
+// AVX2：逐个字符比较后合并掩码，一次处理32个字节
+__attribute__((target("avx2"))) inline size_t findEscapeAvx2(const char* p, size_t n)
+{
+    const __m256i amp = _mm256_set1_epi8('&'), lt = _mm256_set1_epi8('<'), gt = _mm256_set1_epi8('>');
+    const __m256i quot = _mm256_set1_epi8('"'), apos = _mm256_set1_epi8('\'');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, amp), _mm256_cmpeq_epi8(chunk, lt)),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, gt), _mm256_cmpeq_epi8(chunk, quot)),
+                            _mm256_cmpeq_epi8(chunk, apos)));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + findEscapeScalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline uint32_t spaceMaskAvx2(const char* p)
+{
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hit = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+__attribute__((target("avx2"))) inline size_t findSpaceAvx2(const char* p, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        uint32_t mask = spaceMaskAvx2(p + i);
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + findSpaceScalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline size_t findNonSpaceAvx2(const char* p, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        uint32_t mask = ~spaceMaskAvx2(p + i);
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + findNonSpaceScalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void changeCaseAvx2(char* p, size_t n, bool upper)
+{
+    const __m256i shift = _mm256_set1_epi8(static_cast<char>((upper ? 'a' : 'A') + 128));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(-128 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i isLetter = _mm256_cmpgt_epi8(limit, _mm256_sub_epi8(chunk, shift));
+        chunk = _mm256_xor_si256(chunk, _mm256_and_si256(isLetter, flip));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), chunk);
+    }
+    changeCaseScalar(p + i, n - i, upper);
+}
+#endif
+
+inline SimdLevel detectSimd()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#endif
+    return SimdLevel::Scalar;
+}
+
+// 当前使用的指令集，启动时检测一次，测试时可以手动降级
+inline SimdLevel& activeSimd()
+{
+    static SimdLevel level = detectSimd();
+    return level;
+}
+
+inline size_t findEscape(const char* p, size_t n, SimdLevel level)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (level == SimdLevel::AVX2) return findEscapeAvx2(p, n);
+    if (level == SimdLevel::SSE42) return findEscapeSse42(p, n);
+#endif
+    return findEscapeScalar(p, n);
+}
+
+inline size_t findSpace(const char* p, size_t n, SimdLevel level)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (level == SimdLevel::AVX2) return findSpaceAvx2(p, n);
+    if (level == SimdLevel::SSE42) return findSpaceSse42(p, n);
+#endif
+    return findSpaceScalar(p, n);
+}
+
+inline size_t findNonSpace(const char* p, size_t n, SimdLevel level)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (level == SimdLevel::AVX2) return findNonSpaceAvx2(p, n);
+    if (level == SimdLevel::SSE42) return findNonSpaceSse42(p, n);
+#endif
+    return findNonSpaceScalar(p, n);
+}
+
+inline std::string_view escapeEntity(char ch)
+{
+    switch (ch)
+    {
+    case '&': return "&amp;";
+    case '<': return "&lt;";
+    case '>': return "&gt;";
+    case '"': return "&quot;";
+    default: return "&#39;";
+    }
+}
+
+inline void escapeHtml(std::string_view in, std::string& out, SimdLevel level = activeSimd())
+{
+    const char* p = in.data();
+    size_t n = in.size();
+    size_t pos = 0;
+    while (pos < n)
+    {
+        size_t run = findEscape(p + pos, n - pos, level);
+        out.append(p + pos, run);
+        pos += run;
+        if (pos == n) break;
+        out += escapeEntity(p[pos]);
+        ++pos;
+    }
+}
+
+// 原地转义s中[start, s.size())这一段：先统计增加的长度，把原文整体后移这么多字节，
+// 再从前往后写出结果。输出永远不会追上尚未读取的输入，重叠的复制用memmove
+inline void escapeHtmlInPlace(std::string& s, size_t start, SimdLevel level = activeSimd())
+{
+    size_t n = s.size() - start;
+    size_t extra = 0;
+    for (size_t pos = findEscape(s.data() + start, n, level); pos < n;
+         pos += 1 + findEscape(s.data() + start + pos + 1, n - pos - 1, level))
+    {
+        extra += escapeEntity(s[start + pos]).size() - 1;
+    }
+    if (extra == 0) return;
+    s.resize(s.size() + extra);
+    char* p = s.data() + start;
+    std::memmove(p + extra, p, n);
+    size_t read = extra, write = 0, end = extra + n;
+    while (read < end)
+    {
+        size_t run = findEscape(p + read, end - read, level);
+        std::memmove(p + write, p + read, run);
+        write += run;
+        read += run;
+        if (read == end) break;
+        std::string_view entity = escapeEntity(p[read++]);
+        std::memcpy(p + write, entity.data(), entity.size());
+        write += entity.size();
+    }
+}
+
+// 连续的空白字符折叠为一个空格；inSpace记录上一块是否以空白结尾，用于跨块处理
+inline void collapseWhitespace(std::string_view in, std::string& out, bool& inSpace, SimdLevel level = activeSimd())
+{
+    const char* p = in.data();
+    size_t n = in.size();
+    size_t pos = 0;
+    while (pos < n)
+    {
+        if (inSpace)
+        {
+            pos += findNonSpace(p + pos, n - pos, level);
+            if (pos == n) break;
+            inSpace = false;
+        }
+        size_t run = findSpace(p + pos, n - pos, level);
+        out.append(p + pos, run);
+        pos += run;
+        if (pos == n) break;
+        out += ' ';
+        inSpace = true;
+        ++pos;
+    }
+}
+
+// 原地折叠s中[start, s.size())这一段的空白，结果只会变短，写位置始终不超过读位置
+inline void collapseWhitespaceInPlace(std::string& s, size_t start, bool& inSpace, SimdLevel level = activeSimd())
+{
+    char* p = s.data() + start;
+    size_t n = s.size() - start;
+    size_t pos = 0, write = 0;
+    while (pos < n)
+    {
+        if (inSpace)
+        {
+            pos += findNonSpace(p + pos, n - pos, level);
+            if (pos == n) break;
+            inSpace = false;
+        }
+        size_t run = findSpace(p + pos, n - pos, level);
+        if (write != pos) std::memmove(p + write, p + pos, run);
+        write += run;
+        pos += run;
+        if (pos == n) break;
+        p[write++] = ' ';
+        inSpace = true;
+        ++pos;
+    }
+    s.resize(start + write);
+}
+
+inline void changeCaseInPlace(char* p, size_t n, bool upper, SimdLevel level = activeSimd())
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (level == SimdLevel::AVX2) return changeCaseAvx2(p, n, upper);
+    if (level == SimdLevel::SSE42) return changeCaseSse42(p, n, upper);
+#endif
+    changeCaseScalar(p, n, upper);
+}
+
+inline void changeCase(std::string_view in, std::string& out, bool upper, SimdLevel level = activeSimd())
+{
+    size_t start = out.size();
+    out.append(in);
+    changeCaseInPlace(out.data() + start, in.size(), upper, level);
+}
+} // namespace text_kernels
+
+// 变换类装饰器的基类：对下层输出整体或逐块做变换，state供需要跨块状态的变换使用
+class TransformDecorator : public SafeDecorator
 {
 public:
-    UnderlineDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+    explicit TransformDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+
     std::string render() const override
     {
-        return "<u>" + wrapped->render() + "</u>";
+        std::string out;
+        renderTo(out);
+        return out;
+    }
+
+    // 不做变换，只根据下层的长度估计，避免外层预留容量时把整条变换链多执行一遍
+    size_t renderedSize() const override
+    {
+        return estimateSize(wrapped->renderedSize());
+    }
+
+    // 下层直接渲染到out的末尾，再原地变换这一段，不为每一层分配临时字符串
+    void renderTo(std::string& out) const override
+    {
+        size_t start = out.size();
+        out.reserve(start + estimateSize(wrapped->renderedSize()));
+        wrapped->renderTo(out);
+        transformInPlace(out, start);
+    }
+
+    void renderStream(ChunkSink& sink) const override
+    {
+        TransformSink transformed(*this, sink);
+        wrapped->renderStream(transformed);
+    }
+
+protected:
+    virtual void transform(std::string_view in, std::string& out, bool& state) const = 0;
+    // 把out中[start, out.size())替换为变换结果。默认借助临时字符串调用transform，内置的变换都原地完成
+    virtual void transformInPlace(std::string& out, size_t start) const
+    {
+        std::string in(out, start);
+        out.resize(start);
+        bool state = false;
+        transform(in, out, state);
+    }
+    // 由输入长度估计输出长度，默认与输入相同：大小写变换长度不变，合并空白只会变短
+    virtual size_t estimateSize(size_t inputSize) const { return inputSize; }
+
+private:
+    struct TransformSink : ChunkSink
+    {
+        TransformSink(const TransformDecorator& owner, ChunkSink& downstream) : owner_(owner), downstream_(downstream) {}
+        void write(std::string_view chunk) override
+        {
+            buffer_.clear();
+            owner_.transform(chunk, buffer_, state_);
+            downstream_.write(buffer_);
+        }
+        const TransformDecorator& owner_;
+        ChunkSink& downstream_;
+        std::string buffer_;
+        bool state_ = false;
+    };
+};
+
+class HtmlEscapeDecorator : public TransformDecorator
+{
+public:
+    using TransformDecorator::TransformDecorator;
+
+protected:
+    void transform(std::string_view in, std::string& out, bool&) const override
+    {
+        text_kernels::escapeHtml(in, out);
+    }
+    void transformInPlace(std::string& out, size_t start) const override
+    {
+        text_kernels::escapeHtmlInPlace(out, start);
+    }
+    // 最坏情况是6倍（每个字符都转成&quot;），多层转义叠加后会预留出巨大的空间，
+    // 这里按常见文本留出1/8的余量，超出时由string自行扩容一次
+    size_t estimateSize(size_t inputSize) const override { return inputSize + inputSize / 8; }
+};
+
+class CollapseWhitespaceDecorator : public TransformDecorator
+{
+public:
+    using TransformDecorator::TransformDecorator;
+
+protected:
+    void transform(std::string_view in, std::string& out, bool& inSpace) const override
+    {
+        text_kernels::collapseWhitespace(in, out, inSpace);
+    }
+    void transformInPlace(std::string& out, size_t start) const override
+    {
+        bool inSpace = false;
+        text_kernels::collapseWhitespaceInPlace(out, start, inSpace);
+    }
+};
+
+class UpperCaseDecorator : public TransformDecorator
+{
+public:
+    using TransformDecorator::TransformDecorator;
+
+protected:
+    void transform(std::string_view in, std::string& out, bool&) const override
+    {
+        text_kernels::changeCase(in, out, true);
+    }
+    void transformInPlace(std::string& out, size_t start) const override
+    {
+        text_kernels::changeCaseInPlace(out.data() + start, out.size() - start, true);
+    }
+};
+
+class LowerCaseDecorator : public TransformDecorator
+{
+public:
+    using TransformDecorator::TransformDecorator;
+
+protected:
+    void transform(std::string_view in, std::string& out, bool&) const override
+    {
+        text_kernels::changeCase(in, out, false);
     }
+    void transformInPlace(std::string& out, size_t start) const override
+    {
+        text_kernels::changeCaseInPlace(out.data() + start, out.size() - start, false);
+    }
+};
+
+/**
+ * 大文档的流式装饰
+ * FileText按固定大小的块读取文件并逐块交给下游，装饰链只在前后写入标签、原样转发中间的块，
+ * FdSink把小块攒进缓冲区，大块直接写入文件描述符。整条链的内存占用与文档大小无关。
+ */
+
+// 独占的文件描述符，析构时关闭，读写中途抛出异常也不会泄漏
+class UniqueFd {
+public:
+    explicit UniqueFd(int fd) : fd_(fd) {}
+    ~UniqueFd() { if (fd_ >= 0) ::close(fd_); }
+    UniqueFd(const UniqueFd&) = delete;
+    UniqueFd& operator=(const UniqueFd&) = delete;
+    int get() const { return fd_; }
+
+private:
+    int fd_;
 };
 
-int main() {
-    auto text = std::make_unique<BoldDecorator>(std::make_unique<ItalicDecorator>
-                                                (std::make_unique<PlainText>("Hello World")));
-    std::cout << text.get()->render();
+class FileText final : public Text {
+public:
+    explicit FileText(std::string path, size_t chunkSize = 1 << 20)
+        : path_(std::move(path)), chunkSize_(chunkSize) {}
+
+    std::string render() const override {
+        std::string out;
+        out.reserve(renderedSize());
+        renderTo(out);
+        return out;
+    }
+
+    size_t renderedSize() const override {
+        struct stat st;
+        if (::stat(path_.c_str(), &st) != 0) throw std::runtime_error("Cannot stat " + path_);
+        return static_cast<size_t>(st.st_size);
+    }
+
+    void renderTo(std::string& out) const override {
+        StringSink sink(out);
+        renderStream(sink);
+    }
+
+    void renderStream(ChunkSink& sink) const override {
+        UniqueFd fd(::open(path_.c_str(), O_RDONLY));
+        if (fd.get() < 0) throw std::runtime_error("Cannot open " + path_);
+        std::unique_ptr<char[]> buffer(new char[chunkSize_]);
+        for (;;) {
+            ssize_t n = ::read(fd.get(), buffer.get(), chunkSize_);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("Failed to read " + path_);
+            if (n == 0) break;
+            sink.write(std::string_view(buffer.get(), static_cast<size_t>(n)));
+        }
+    }
+
+private:
+    struct StringSink : ChunkSink {
+        explicit StringSink(std::string& out) : out_(out) {}
+        void write(std::string_view chunk) override { out_ += chunk; }
+        std::string& out_;
+    };
+
+    std::string path_;
+    size_t chunkSize_;
+};
+
+// 不拥有文件描述符。析构时会写出剩余内容，但不能再抛出异常，
+// 写出失败（EPIPE、磁盘已满等）在析构中只能丢弃，需要得知错误的调用方应在析构前显式调用flush()
+class FdSink final : public ChunkSink {
+public:
+    explicit FdSink(int fd, size_t bufferSize = 1 << 16) : fd_(fd), buffer_(bufferSize) {}
+    ~FdSink() override {
+        try {
+            flush();
+        } catch (const std::exception&) {
+        }
+    }
+
+    FdSink(const FdSink&) = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    void write(std::string_view chunk) override {
+        if (used_ + chunk.size() > buffer_.size()) {
+            flush();
+            // 比缓冲区还大的块不再拷贝，直接写出
+            if (chunk.size() >= buffer_.size()) {
+                writeAll(chunk.data(), chunk.size());
+                return;
+            }
+        }
+        std::copy(chunk.begin(), chunk.end(), buffer_.data() + used_);
+        used_ += chunk.size();
+    }
+
+    // 失败时抛出runtime_error，未写出的内容被丢弃
+    void flush() {
+        size_t pending = used_;
+        used_ = 0;
+        writeAll(buffer_.data(), pending);
+    }
+
+    size_t bytesWritten() const { return written_; }
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    size_t written_ = 0;
+
+    void writeAll(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd_, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("Failed to write output");
+            data += n;
+            size -= static_cast<size_t>(n);
+            written_ += static_cast<size_t>(n);
+        }
+    }
+};
+
+// 对照组：原先每层渲染都加互斥锁的实现
+namespace locked_baseline
+{
+class PlainText final : public Text {
+public:
+    explicit PlainText(std::string content) : content_(std::move(content)) {}
+    std::string render() const override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return content_;
+    }
+private:
+    mutable std::mutex mtx_;
+    std::string content_;
+};
+
+class SafeDecorator : public Text {
+public:
+    explicit SafeDecorator(std::unique_ptr<Text> t) : wrapped(std::move(t)) {}
+    std::string render() const override {
+        std::lock_guard<std::mutex> lock(mtx);
+        return wrapped->render();
+    }
+protected:
+    std::unique_ptr<Text> wrapped;
+    mutable std::mutex mtx;
+};
+
+class BoldDecorator : public SafeDecorator {
+public:
+    BoldDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+    std::string render() const override {
+        std::lock_guard<std::mutex> lock(mtx);
+        return "<b>" + wrapped->render() + "</b>";
+    }
+};
+
+class ItalicDecorator : public SafeDecorator {
+public:
+    ItalicDecorator(std::unique_ptr<Text> t) : SafeDecorator(std::move(t)) {}
+    std::string render() const override {
+        return "<i>" + wrapped->render() + "</i>";
+    }
+};
+} // namespace locked_baseline
+
+// 性能测试：1到64个线程同时渲染同一个三层装饰链，统计每秒渲染次数
+static double rendersPerSecond(const Text& text, unsigned threads)
+{
+    const auto duration = std::chrono::milliseconds(300);
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> total{0};
+    std::atomic<size_t> bytesSink{0}; // 累加输出长度，防止渲染结果被优化掉
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        pool.emplace_back([&] {
+            size_t local = 0, bytes = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                bytes += text.render().size();
+                ++local;
+            }
+            total += local;
+            bytesSink += bytes;
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto& th : pool) th.join();
+    return total.load() / std::chrono::duration<double>(duration).count();
+}
+
+static void benchmarkConcurrentRender()
+{
+    auto lockFree = std::make_unique<BoldDecorator>(std::make_unique<ItalicDecorator>
+                                                    (std::make_unique<PlainText>("Hello World")));
+    auto locked = std::make_unique<locked_baseline::BoldDecorator>(std::make_unique<locked_baseline::ItalicDecorator>
+                                                    (std::make_unique<locked_baseline::PlainText>("Hello World")));
+    for (unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+        std::cout << "threads=" << threads
+                  << " lock-free=" << rendersPerSecond(*lockFree, threads) << " renders/s"
+                  << ", mutex=" << rendersPerSecond(*locked, threads) << " renders/s" << std::endl;
+    }
+}
+
+// 对照组：每层都用字符串拼接返回新字符串的实现
+class ConcatDecorator : public Text
+{
+public:
+    ConcatDecorator(std::unique_ptr<Text> t, std::string open, std::string close)
+        : wrapped_(std::move(t)), open_(std::move(open)), close_(std::move(close)) {}
+    std::string render() const override { return open_ + wrapped_->render() + close_; }
+private:
+    std::unique_ptr<Text> wrapped_;
+    std::string open_;
+    std::string close_;
+};
+
+// 性能测试：10层装饰链渲染1KB与1MB的内容，单次分配与逐层拼接的对比
+static void benchmarkSingleAllocation()
+{
+    using Clock = std::chrono::steady_clock;
+    for (size_t payload : {size_t(1) << 10, size_t(1) << 20})
+    {
+        std::unique_ptr<Text> sized = std::make_unique<PlainText>(std::string(payload, 'x'));
+        std::unique_ptr<Text> concat = std::make_unique<PlainText>(std::string(payload, 'x'));
+        for (int layer = 0; layer < 10; ++layer)
+        {
+            switch (layer % 3)
+            {
+            case 0:
+                sized = std::make_unique<BoldDecorator>(std::move(sized));
+                concat = std::make_unique<ConcatDecorator>(std::move(concat), "<b>", "</b>");
+                break;
+            case 1:
+                sized = std::make_unique<ItalicDecorator>(std::move(sized));
+                concat = std::make_unique<ConcatDecorator>(std::move(concat), "<i>", "</i>");
+                break;
+            default:
+                sized = std::make_unique<UnderlineDecorator>(std::move(sized));
+                concat = std::make_unique<ConcatDecorator>(std::move(concat), "<u>", "</u>");
+                break;
+            }
+        }
+        const int iterations = payload > 4096 ? 200 : 200000;
+        size_t bytes = 0;
+        auto t0 = Clock::now();
+        for (int i = 0; i < iterations; ++i) bytes += sized->render().size();
+        double sizedUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / iterations;
+        auto t1 = Clock::now();
+        for (int i = 0; i < iterations; ++i) bytes += concat->render().size();
+        double concatUs = std::chrono::duration<double, std::micro>(Clock::now() - t1).count() / iterations;
+        bool same = sized->render() == concat->render();
+        std::cout << "payload=" << payload << "B depth=10 single allocation=" << sizedUs << "us"
+                  << ", concatenation=" << concatUs << "us" << (same ? "" : " (MISMATCH)")
+                  << " (" << bytes / iterations / 2 << "B per render)" << std::endl;
+    }
+}
+
+// 性能测试：编译期组合与运行时装饰链的构造和渲染耗时对比
+static void benchmarkStaticComposition()
+{
+    using Clock = std::chrono::steady_clock;
+    const int iterations = 1000000;
+    size_t bytes = 0;
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto text = std::make_unique<UnderlineDecorator>(std::make_unique<BoldDecorator>(
+                        std::make_unique<ItalicDecorator>(std::make_unique<PlainText>("Hello World"))));
+        bytes += text->renderedSize();
+    }
+    double dynamicBuildNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / iterations;
+    auto t1 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto text = std::make_unique<Decorated<PlainText, layer::Italic, layer::Bold, layer::Underline>>("Hello World");
+        bytes += text->renderedSize();
+    }
+    double staticBuildNs = std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / iterations;
+
+    auto dynamicText = std::make_unique<UnderlineDecorator>(std::make_unique<BoldDecorator>(
+                           std::make_unique<ItalicDecorator>(std::make_unique<PlainText>("Hello World"))));
+    Decorated<PlainText, layer::Italic, layer::Bold, layer::Underline> staticText("Hello World");
+    std::string out;
+    auto t2 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        out.clear();
+        dynamicText->renderTo(out);
+        bytes += out.size();
+    }
+    double dynamicRenderNs = std::chrono::duration<double, std::nano>(Clock::now() - t2).count() / iterations;
+    auto t3 = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        out.clear();
+        staticText.renderTo(out);
+        bytes += out.size();
+    }
+    double staticRenderNs = std::chrono::duration<double, std::nano>(Clock::now() - t3).count() / iterations;
+
+    bool same = dynamicText->render() == staticText.render();
+    std::cout << "3 layers: build dynamic=" << dynamicBuildNs << "ns, static=" << staticBuildNs << "ns"
+              << "; render dynamic=" << dynamicRenderNs << "ns, static=" << staticRenderNs << "ns"
+              << (same ? "" : " (MISMATCH)") << " (" << bytes % 7 << ")" << std::endl;
+}
+
+// 性能测试：模拟页面反复重绘。1000个经过HTML转义和10层装饰的文档按热度不均匀地被渲染，1%的操作修改内容，
+// 字节预算只能容纳约一半文档，统计命中率和平均渲染延迟
+static void benchmarkRenderCache()
+{
+    using Clock = std::chrono::steady_clock;
+    const int documents = 1000;
+    const size_t payload = 4096;
+    const int operations = 200000;
+    RenderCache& cache = RenderCache::global();
+    cache.setBudget(documents / 2 * (payload + 64));
+
+    // HTML转义加10层装饰，缓存加在其上；转义让未命中的渲染有实际的计算量
+    auto decorate = [](std::unique_ptr<Text> text) {
+        text = std::make_unique<HtmlEscapeDecorator>(std::move(text));
+        for (int layer = 0; layer < 10; ++layer)
+        {
+            if (layer % 2 == 0) text = std::make_unique<BoldDecorator>(std::move(text));
+            else text = std::make_unique<ItalicDecorator>(std::move(text));
+        }
+        return text;
+    };
+    // 每32个字符带一个需要转义的字符
+    auto makePayload = [payload](char fill) {
+        std::string content(payload, fill);
+        for (size_t i = 0; i < payload; i += 32) content[i] = '<';
+        return content;
+    };
+    // 缓存层外面再包一层，走外层装饰器先取长度再渲染的路径
+    std::vector<PlainText*> contents;
+    std::vector<CachedDecorator*> cachedLayers;
+    std::vector<std::unique_ptr<Text>> cachedDocs;
+    std::vector<std::unique_ptr<Text>> plainDocs;
+    for (int d = 0; d < documents; ++d)
+    {
+        auto plain = std::make_unique<PlainText>(makePayload(static_cast<char>('a' + d % 26)));
+        contents.push_back(plain.get());
+        auto cached = std::make_unique<CachedDecorator>(decorate(std::move(plain)));
+        cachedLayers.push_back(cached.get());
+        cachedDocs.push_back(std::make_unique<UnderlineDecorator>(std::move(cached)));
+        plainDocs.push_back(std::make_unique<UnderlineDecorator>(
+            decorate(std::make_unique<PlainText>(makePayload('x')))));
+    }
+
+    // 幂律分布的访问热度
+    std::mt19937 rng(42);
+    std::vector<double> weights(documents);
+    for (int d = 0; d < documents; ++d) weights[d] = 1.0 / (d + 1);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    std::vector<int> sequence(operations);
+    for (auto& doc : sequence) doc = pick(rng);
+
+    size_t bytes = 0;
+    auto runCached = [&](bool shared) {
+        cache.resetStats();
+        auto start = Clock::now();
+        for (int i = 0; i < operations; ++i)
+        {
+            if (i % 100 == 0) contents[sequence[i]]->setContent(makePayload(static_cast<char>('A' + i % 26)));
+            if (shared) bytes += cachedLayers[sequence[i]]->cached()->size();
+            else bytes += cachedDocs[sequence[i]]->render().size();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+    };
+    double cachedNs = runCached(false);
+    RenderCache::Stats stats = cache.stats();
+    double sharedNs = runCached(true);
+
+    auto t1 = Clock::now();
+    for (int i = 0; i < operations; ++i) bytes += plainDocs[sequence[i]]->render().size();
+    double plainNs = std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / operations;
+
+    std::cout << "documents=" << documents << " payload=" << payload << "B"
+              << " hit rate=" << 100.0 * stats.hits / (stats.hits + stats.misses) << "%"
+              << ", lookups/render=" << static_cast<double>(stats.hits + stats.misses) / operations
+              << ", evictions=" << stats.evictions << ", cached bytes=" << stats.bytes
+              << "; avg render cached copy=" << cachedNs << "ns, cached shared=" << sharedNs
+              << "ns, uncached=" << plainNs << "ns"
+              << " (" << bytes % 7 << ")" << std::endl;
+}
+
+static long peakRssKb()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 性能测试：大文件经过10层装饰输出到/dev/null，流式与整串渲染的吞吐和峰值内存对比
+// 峰值内存只增不减，所以先测流式
+static void benchmarkStreaming(size_t size)
+{
+    using Clock = std::chrono::steady_clock;
+    const std::string path = "/tmp/decorator_stream_bench.txt";
+    {
+        UniqueFd fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (fd.get() < 0) throw std::runtime_error("Cannot create " + path);
+        FdSink sink(fd.get(), 1 << 20);
+        std::string block(1 << 20, 'x');
+        for (size_t done = 0; done < size; done += block.size()) {
+            sink.write(std::string_view(block.data(), std::min(block.size(), size - done)));
+        }
+        sink.flush();
+    }
+    auto decorate = [](std::unique_ptr<Text> text) {
+        for (int layer = 0; layer < 10; ++layer) {
+            if (layer % 2 == 0) text = std::make_unique<BoldDecorator>(std::move(text));
+            else text = std::make_unique<ItalicDecorator>(std::move(text));
+        }
+        return text;
+    };
+    UniqueFd devNullFd(::open("/dev/null", O_WRONLY));
+    int devNull = devNullFd.get();
+    long rssBefore = peakRssKb();
+
+    std::unique_ptr<Text> streamed = decorate(std::make_unique<FileText>(path));
+    auto t0 = Clock::now();
+    size_t written;
+    {
+        FdSink sink(devNull);
+        streamed->renderStream(sink);
+        sink.flush();
+        written = sink.bytesWritten();
+    }
+    double streamSec = std::chrono::duration<double>(Clock::now() - t0).count();
+    long rssStream = peakRssKb();
+
+    auto t1 = Clock::now();
+    std::string whole = streamed->render();
+    {
+        FdSink sink(devNull);
+        sink.write(whole);
+        sink.flush();
+    }
+    double wholeSec = std::chrono::duration<double>(Clock::now() - t1).count();
+    long rssWhole = peakRssKb();
+
+    std::cout << "input=" << size / (1 << 20) << "MB output=" << written / (1 << 20) << "MB"
+              << " streaming: " << written / streamSec / (1 << 20) << "MB/s, peak RSS +" << (rssStream - rssBefore) / 1024 << "MB"
+              << "; render(): " << whole.size() / wholeSec / (1 << 20) << "MB/s, peak RSS +" << (rssWhole - rssStream) / 1024 << "MB"
+              << std::endl;
+    std::remove(path.c_str());
+}
+
+// 逐字符实现的参照版本，用于逐字节校验各指令集的结果
+namespace reference
+{
+inline std::string escapeHtml(std::string_view in)
+{
+    std::string out;
+    for (char ch : in)
+    {
+        if (ch == '&') out += "&amp;";
+        else if (ch == '<') out += "&lt;";
+        else if (ch == '>') out += "&gt;";
+        else if (ch == '"') out += "&quot;";
+        else if (ch == '\'') out += "&#39;";
+        else out += ch;
+    }
+    return out;
+}
+
+inline std::string collapseWhitespace(std::string_view in)
+{
+    std::string out;
+    bool inSpace = false;
+    for (char ch : in)
+    {
+        bool space = ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+        if (!space) out += ch;
+        else if (!inSpace) out += ' ';
+        inSpace = space;
+    }
+    return out;
+}
+
+inline std::string changeCase(std::string_view in, bool upper)
+{
+    std::string out(in);
+    for (char& ch : out)
+    {
+        if (upper && ch >= 'a' && ch <= 'z') ch = static_cast<char>(ch - 'a' + 'A');
+        if (!upper && ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+    }
+    return out;
+}
+} // namespace reference
+
+// 性能测试：先用随机文本逐字节校验各指令集版本与参照实现一致，再测量吞吐
+static void benchmarkTextKernels()
+{
+    using namespace text_kernels;
+    using Clock = std::chrono::steady_clock;
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    if (detectSimd() != SimdLevel::Scalar) levels.push_back(SimdLevel::SSE42);
+    if (detectSimd() == SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    // 校验：包含全部特殊字符、非ASCII字节和各种长度的边界情况
+    std::mt19937 rng(42);
+    const char alphabet[] = "abcXYZ09&<>\"' \t\n\r\x80\xff@[`{";
+    size_t failures = 0, cases = 0;
+    for (int round = 0; round < 2000; ++round)
+    {
+        std::string input(rng() % 200, '\0');
+        for (char& ch : input) ch = alphabet[rng() % (sizeof(alphabet) - 1)];
+        for (SimdLevel level : levels)
+        {
+            std::string escaped, collapsed, upper, lower;
+            escapeHtml(input, escaped, level);
+            // 拆成两块校验跨块状态
+            bool inSpace = false;
+            size_t split = input.empty() ? 0 : rng() % input.size();
+            collapseWhitespace(std::string_view(input).substr(0, split), collapsed, inSpace, level);
+            collapseWhitespace(std::string_view(input).substr(split), collapsed, inSpace, level);
+            changeCase(input, upper, true, level);
+            changeCase(input, lower, false, level);
+            failures += escaped != reference::escapeHtml(input);
+            failures += collapsed != reference::collapseWhitespace(input);
+            failures += upper != reference::changeCase(input, true);
+            failures += lower != reference::changeCase(input, false);
+            // 原地版本：在已有前缀之后变换
+            std::string escapedInPlace = "<p>" + input, collapsedInPlace = "<p>" + input;
+            escapeHtmlInPlace(escapedInPlace, 3, level);
+            inSpace = false;
+            collapseWhitespaceInPlace(collapsedInPlace, 3, inSpace, level);
+            failures += escapedInPlace != "<p>" + reference::escapeHtml(input);
+            failures += collapsedInPlace != "<p>" + reference::collapseWhitespace(input);
+            cases += 6;
+        }
+    }
+    std::cout << "byte-for-byte check: " << cases << " cases, " << failures << " failures" << std::endl;
+
+    // 嵌套的变换层被外层装饰后，每层在一次渲染中只应执行一遍变换
+    struct CountingTransform : TransformDecorator
+    {
+        using TransformDecorator::TransformDecorator;
+        std::atomic<size_t>* calls = nullptr;
+        void transform(std::string_view in, std::string& out, bool&) const override
+        {
+            ++*calls;
+            out.append(in);
+        }
+    };
+    std::atomic<size_t> transformCalls{0};
+    std::unique_ptr<Text> nested = std::make_unique<PlainText>("nested");
+    const int nestedLayers = 8;
+    for (int layer = 0; layer < nestedLayers; ++layer)
+    {
+        auto counting = std::make_unique<CountingTransform>(std::move(nested));
+        counting->calls = &transformCalls;
+        nested = std::make_unique<BoldDecorator>(std::move(counting));
+    }
+    nested->render();
+    std::cout << "nested transforms: " << nestedLayers << " layers, " << transformCalls.load()
+              << " transform passes per render" << std::endl;
+
+    // 吞吐：64MB普通文本，约2%为需要转义的字符
+    std::string text(64 << 20, '\0');
+    for (char& ch : text)
+    {
+        uint32_t r = rng() % 100;
+        ch = r < 2 ? "&<>\"'"[rng() % 5] : r < 15 ? ' ' : static_cast<char>('a' + r % 26);
+    }
+    std::string out;
+    out.reserve(text.size() * 2);
+    auto measure = [&](auto&& fn) {
+        auto start = Clock::now();
+        out.clear();
+        fn();
+        return text.size() / std::chrono::duration<double>(Clock::now() - start).count() / 1e9;
+    };
+    for (SimdLevel level : levels)
+    {
+        double escape = measure([&] { escapeHtml(text, out, level); });
+        double collapse = measure([&] { bool inSpace = false; collapseWhitespace(text, out, inSpace, level); });
+        double upper = measure([&] { changeCase(text, out, true, level); });
+        std::cout << levelName(level) << ": escape=" << escape << "GB/s, collapse whitespace=" << collapse
+                  << "GB/s, upper case=" << upper << "GB/s" << std::endl;
+    }
+}
+
+// 运行 ./decorator_improvedAns bench <concurrent|alloc|static|cache|stream [字节数]|simd> 进行性能测试，建议使用 -O2 编译
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "bench")
+    {
+        std::string name = argv[2];
+        if (name == "concurrent")
+        {
+            benchmarkConcurrentRender();
+        }
+        else if (name == "alloc")
+        {
+            benchmarkSingleAllocation();
+        }
+        else if (name == "static")
+        {
+            benchmarkStaticComposition();
+        }
+        else if (name == "cache")
+        {
+            benchmarkRenderCache();
+        }
+        else if (name == "stream")
+        {
+            benchmarkStreaming(argc > 3 ? std::strtoull(argv[3], nullptr, 10) : size_t(1) << 30);
+        }
+        else if (name == "simd")
+        {
+            benchmarkTextKernels();
+        }
+        else
+        {
+            std::cout << "Unknown benchmark: " << name << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    auto plain = std::make_unique<PlainText>("Hello World");
+    PlainText* content = plain.get();
+    auto text = std::make_unique<BoldDecorator>(std::make_unique<ItalicDecorator>(std::move(plain)));
+    std::cout << text.get()->render() << std::endl;
+    content->setContent("Hello Decorator");
+    std::cout << text.get()->render() << std::endl;
+
+    // 编译期组合，并与运行时装饰器互相包装
+    Decorated<PlainText, layer::Italic, layer::Bold> staticText("Hello World");
+    std::cout << staticText.render() << std::endl;
+    UnderlineDecorator mixed(std::make_unique<Decorated<RuntimeText, layer::Bold>>(
+        std::make_unique<ItalicDecorator>(std::make_unique<PlainText>("Hello World"))));
+    std::cout << mixed.render() << std::endl;
+
+    // 缓存装饰器：内容不变时直接命中，修改后自动失效
+    auto cachedPlain = std::make_unique<PlainText>("Hello Cache");
+    PlainText* cachedContent = cachedPlain.get();
+    CachedDecorator cached(std::make_unique<BoldDecorator>(std::move(cachedPlain)));
+    cached.render();
+    cached.render();
+    cachedContent->setContent("Hello Again");
+    std::cout << cached.render() << std::endl;
+    RenderCache::Stats stats = RenderCache::global().stats();
+    std::cout << "cache hits=" << stats.hits << ", misses=" << stats.misses << std::endl;
+
+    // 流式渲染，直接写到标准输出的文件描述符
+    {
+        FdSink out(STDOUT_FILENO);
+        BoldDecorator streamed(std::make_unique<ItalicDecorator>(std::make_unique<PlainText>("Hello Stream")));
+        streamed.renderStream(out);
+        out.write("\n");
+        out.flush();
+    }
+
+    // 转义与变换装饰器
+    HtmlEscapeDecorator escaped(std::make_unique<BoldDecorator>(std::make_unique<PlainText>("Tom & \"Jerry\"")));
+    std::cout << escaped.render() << std::endl;
+    UpperCaseDecorator shout(std::make_unique<CollapseWhitespaceDecorator>(
+        std::make_unique<PlainText>("hello   \t  simd\n\n world")));
+    std::cout << shout.render() << " (" << text_kernels::levelName(text_kernels::activeSimd()) << ")";
     return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,26 @@
 #include <iostream>
 #include <string>
+#include <functional>
 #include <unordered_map>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <charconv>
+#include <fstream>
+#include <string_view>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 class TreeType
 {
@@ -21,6 +41,7 @@ private:
 class Tree
 {
 public:
+    Tree() : _x(0), _y(0), _age(0), _treeType(nullptr) {}
     Tree(int x, int y, int age, TreeType* treeType) :
     _x(x), _y(y), _age(age), _treeType(treeType) {}
 
@@ -32,6 +53,11 @@ public:
                   << "Position: (" << _x << ", " << _y << "), Age: " << _age << std::endl; 
     }
 
+    int GetX() const {return _x;}
+    int GetY() const {return _y;}
+    int GetAge() const {return _age;}
+    TreeType* GetTreeType() const {return _treeType;}
+
 private:
     int _x;
     int _y;
@@ -39,18 +65,126 @@ private:
     TreeType* _treeType;
 };
 
+/**
+ * 享元工厂
+ * getTreeType()取得的类型会一直保留到工厂析构，与原有用法一致。
+ * 流式加载的场景可以改用acquire()/release()成对引用计数：引用归零的类型进入LRU链表，
+ * 当全部享元占用的字节数超过预算时，从最久未使用的一端淘汰未使用的享元，直到回到预算以内。
+ * 仍被引用或固定的享元不会被淘汰，因此它们本身超出预算时总字节数可以暂时高于预算。
+ */
 class TreeFactory
 {
 public:
+    struct Stats
+    {
+        size_t liveTypes = 0;      // 当前持有的享元数量
+        size_t unusedTypes = 0;    // 引用归零、等待淘汰的数量
+        size_t references = 0;     // acquire()持有的引用总数
+        size_t uses = 0;           // 实际使用享元的对象数：给定森林时为树的数量，否则等于references
+        size_t sharedBytes = 0;    // 享元本身占用的字节数
+        size_t savedBytes = 0;     // 相比每个使用者各存一份内部状态节省的字节数
+        size_t evictedTypes = 0;   // 累计淘汰的数量
+    };
+
+    // byteBudget为享元总字节数的上限，0表示不限制
+    explicit TreeFactory(size_t byteBudget = 0) : _byteBudget(byteBudget) {}
+
     ~TreeFactory()
     {
         for (auto treeType : _treeTypes)
         {
-            delete treeType.second;
+            delete treeType.second.type;
         }
     }
 
+    TreeFactory(const TreeFactory&) = delete;
+    TreeFactory& operator=(const TreeFactory&) = delete;
+
     TreeType* getTreeType(const std::string& name, const std::string& color, const std::string& texture)
+    {
+        Entry& entry = find(name, color, texture);
+        entry.pinned = true;
+        reclaim(entry);
+        return entry.type;
+    }
+
+    // 引用计数方式获取享元，使用完毕后需调用release()
+    TreeType* acquire(const std::string& name, const std::string& color, const std::string& texture)
+    {
+        Entry& entry = find(name, color, texture);
+        reclaim(entry);
+        ++entry.refs;
+        return entry.type;
+    }
+
+    void release(TreeType* treeType)
+    {
+        auto searchRes = _entryOf.find(treeType);
+        if (searchRes == _entryOf.end() || searchRes->second->refs == 0) return;
+        Entry& entry = *searchRes->second;
+        if (--entry.refs == 0 && !entry.pinned)
+        {
+            _unused.push_front(entry.key);
+            entry.lruPos = _unused.begin();
+            entry.inLru = true;
+            enforceBudget();
+        }
+    }
+
+    // 立即淘汰所有引用归零的享元
+    void evictUnused()
+    {
+        while (!_unused.empty()) evictOldest();
+    }
+
+    // 按acquire()的引用计算节省的字节数
+    Stats stats() const
+    {
+        return collectStats([](const Entry& entry) { return entry.refs; });
+    }
+
+    // 按森林中实际引用每种享元的树计算，适用于getTreeType()取得一次类型、被大量树共享的用法
+    Stats stats(const std::vector<Tree>& forest) const
+    {
+        std::unordered_map<const TreeType*, size_t> treesOf;
+        for (const auto& tree : forest) ++treesOf[tree.GetTreeType()];
+        return collectStats([&treesOf](const Entry& entry) {
+            auto searchRes = treesOf.find(entry.type);
+            return searchRes == treesOf.end() ? size_t(0) : searchRes->second;
+        });
+    }
+
+private:
+    struct Entry
+    {
+        std::string key;
+        TreeType* type = nullptr;
+        size_t refs = 0;
+        size_t bytes = 0;
+        bool pinned = false;
+        bool inLru = false;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    std::unordered_map<std::string, Entry> _treeTypes;
+    std::unordered_map<TreeType*, Entry*> _entryOf; // unordered_map的元素地址在rehash后保持不变
+    std::list<std::string> _unused;                 // 引用归零的享元，表头为最近释放
+    size_t _byteBudget;
+    size_t _totalBytes = 0;
+    size_t _evicted = 0;
+
+    // 加入分隔符，避免"ab"+"c"与"a"+"bc"生成相同的键
+    std::string GenerateKey(const std::string& name, const std::string& color, const std::string& texture)
+    {
+        return name + '\0' + color + '\0' + texture;
+    }
+
+    static size_t byteSize(const TreeType& type)
+    {
+        return sizeof(TreeType) + type.GetName().size() + type.GetColor().size() + type.GetTexture().size();
+    }
+
+    Entry& find(const std::string& name, const std::string& color, const std::string& texture)
     {
         std::string key = GenerateKey(name, color, texture);
         auto searchRes = _treeTypes.find(key);
@@ -58,26 +192,1022 @@ public:
         {
             return searchRes->second;
         }
+        Entry& entry = _treeTypes[key];
+        entry.key = key;
+        entry.type = new TreeType(name, color, texture);
+        entry.bytes = byteSize(*entry.type);
+        _entryOf.insert(std::make_pair(entry.type, &entry));
+        _totalBytes += entry.bytes;
+        // 新享元尚未被引用也不在LRU链表中，淘汰只会作用于其他未使用的享元
+        enforceBudget();
+        return entry;
+    }
+
+    // 若该享元正在等待淘汰则把它从LRU链表中取回
+    void reclaim(Entry& entry)
+    {
+        if (entry.inLru)
+        {
+            _unused.erase(entry.lruPos);
+            entry.inLru = false;
+        }
+    }
+
+    void enforceBudget()
+    {
+        if (_byteBudget == 0) return;
+        while (!_unused.empty() && _totalBytes > _byteBudget) evictOldest();
+    }
+
+    template <typename UsesOf>
+    Stats collectStats(UsesOf usesOf) const
+    {
+        Stats stats;
+        stats.liveTypes = _treeTypes.size();
+        stats.unusedTypes = _unused.size();
+        stats.evictedTypes = _evicted;
+        for (const auto& item : _treeTypes)
+        {
+            const Entry& entry = item.second;
+            size_t uses = usesOf(entry);
+            stats.references += entry.refs;
+            stats.uses += uses;
+            stats.sharedBytes += entry.bytes;
+            if (uses > 1) stats.savedBytes += (uses - 1) * entry.bytes;
+        }
+        return stats;
+    }
+
+    void evictOldest()
+    {
+        auto searchRes = _treeTypes.find(_unused.back());
+        _unused.pop_back();
+        Entry& entry = searchRes->second;
+        _totalBytes -= entry.bytes;
+        _entryOf.erase(entry.type);
+        delete entry.type;
+        _treeTypes.erase(searchRes);
+        ++_evicted;
+    }
+};
+
+/**
+ * 均匀网格空间索引
+ * 网格只保存树在森林数组中的下标，不拷贝外部状态，享元对象仍由TreeFactory统一管理。
+ * 每个格子记录下标列表，另外记录每棵树在格子中的位置，删除时用"交换到末尾再弹出"做到O(1)。
+ * 超出世界范围的坐标被夹到边缘格子中，查询时仍按真实坐标判断。
+ */
+class TreeGrid
+{
+public:
+    TreeGrid(const std::vector<Tree>& forest, int minX, int minY, int maxX, int maxY, int cellSize) :
+    _forest(forest), _minX(minX), _minY(minY), _cellSize(cellSize)
+    {
+        if (cellSize <= 0 || maxX <= minX || maxY <= minY)
+        {
+            throw std::invalid_argument("Invalid grid bounds");
+        }
+        _cols = (maxX - minX + cellSize - 1) / cellSize;
+        _rows = (maxY - minY + cellSize - 1) / cellSize;
+        _cells.resize(static_cast<size_t>(_cols) * _rows);
+    }
+
+    // 批量建立索引：先统计每个格子的数量再一次性reserve，避免反复扩容
+    void bulkLoad()
+    {
+        for (auto& cell : _cells) cell.clear();
+        std::vector<uint32_t> counts(_cells.size(), 0);
+        for (const auto& tree : _forest)
+        {
+            counts[cellOf(tree.GetX(), tree.GetY())]++;
+        }
+        for (size_t i = 0; i < _cells.size(); ++i)
+        {
+            _cells[i].reserve(counts[i]);
+        }
+        _slots.assign(_forest.size(), kNotIndexed);
+        for (uint32_t i = 0; i < _forest.size(); ++i)
+        {
+            auto& cell = _cells[cellOf(_forest[i].GetX(), _forest[i].GetY())];
+            _slots[i] = static_cast<uint32_t>(cell.size());
+            cell.push_back(i);
+        }
+    }
+
+    // 增量插入：树已经追加到森林数组中，这里只登记它的下标
+    void insert(uint32_t treeIndex)
+    {
+        if (treeIndex >= _slots.size()) _slots.resize(treeIndex + 1, kNotIndexed);
+        if (_slots[treeIndex] != kNotIndexed) return;
+        const Tree& tree = _forest[treeIndex];
+        auto& cell = _cells[cellOf(tree.GetX(), tree.GetY())];
+        _slots[treeIndex] = static_cast<uint32_t>(cell.size());
+        cell.push_back(treeIndex);
+    }
+
+    // 增量删除：要求树的坐标在插入后没有改变
+    void remove(uint32_t treeIndex)
+    {
+        if (treeIndex >= _slots.size() || _slots[treeIndex] == kNotIndexed) return;
+        const Tree& tree = _forest[treeIndex];
+        auto& cell = _cells[cellOf(tree.GetX(), tree.GetY())];
+        uint32_t slot = _slots[treeIndex];
+        uint32_t moved = cell.back();
+        cell[slot] = moved;
+        _slots[moved] = slot;
+        cell.pop_back();
+        _slots[treeIndex] = kNotIndexed;
+    }
+
+    // 区域查询，区间为闭区间[x0, x1] x [y0, y1]，结果追加到out中
+    void query(int x0, int y0, int x1, int y1, std::vector<uint32_t>& out) const
+    {
+        if (x0 > x1 || y0 > y1) return;
+        int c0 = colOf(x0), c1 = colOf(x1);
+        int r0 = rowOf(y0), r1 = rowOf(y1);
+        for (int r = r0; r <= r1; ++r)
+        {
+            for (int c = c0; c <= c1; ++c)
+            {
+                const auto& cell = _cells[static_cast<size_t>(r) * _cols + c];
+                if (cellInside(c, r, x0, y0, x1, y1))
+                {
+                    // 格子完全落在视口内，不需要逐个判断坐标
+                    out.insert(out.end(), cell.begin(), cell.end());
+                    continue;
+                }
+                for (uint32_t idx : cell)
+                {
+                    const Tree& tree = _forest[idx];
+                    if (tree.GetX() >= x0 && tree.GetX() <= x1 && tree.GetY() >= y0 && tree.GetY() <= y1)
+                    {
+                        out.push_back(idx);
+                    }
+                }
+            }
+        }
+    }
+
+    // 只对可见的树类型去访问享元数据，每种类型只返回一次
+    std::vector<TreeType*> visibleTypes(const std::vector<uint32_t>& indices) const
+    {
+        std::vector<TreeType*> types;
+        for (uint32_t idx : indices)
+        {
+            TreeType* type = _forest[idx].GetTreeType();
+            if (std::find(types.begin(), types.end(), type) == types.end())
+            {
+                types.push_back(type);
+            }
+        }
+        return types;
+    }
+
+private:
+    static constexpr uint32_t kNotIndexed = UINT32_MAX;
+
+    const std::vector<Tree>& _forest;
+    int _minX;
+    int _minY;
+    int _cellSize;
+    int _cols;
+    int _rows;
+    std::vector<std::vector<uint32_t>> _cells;
+    std::vector<uint32_t> _slots; // 树下标 -> 在所属格子中的位置
+
+    int colOf(int x) const {return std::clamp((x - _minX) / _cellSize, 0, _cols - 1);}
+    int rowOf(int y) const {return std::clamp((y - _minY) / _cellSize, 0, _rows - 1);}
+    size_t cellOf(int x, int y) const {return static_cast<size_t>(rowOf(y)) * _cols + colOf(x);}
+
+    // 边缘格子可能收纳了越界的树，不能当作"完全在内"处理
+    bool cellInside(int c, int r, int x0, int y0, int x1, int y1) const
+    {
+        if (c == 0 || r == 0 || c == _cols - 1 || r == _rows - 1) return false;
+        int cx0 = _minX + c * _cellSize, cy0 = _minY + r * _cellSize;
+        return cx0 >= x0 && cy0 >= y0 && cx0 + _cellSize - 1 <= x1 && cy0 + _cellSize - 1 <= y1;
+    }
+};
+
+/**
+ * 按TreeType分桶的批量渲染器
+ * 同一享元类型的树共用一个批次，批次内只保存紧凑的外部状态数组，对应实例化绘制的一次draw call。
+ * 输出先写入大块缓冲区，满了再整体写出，避免逐行经过std::cout和std::endl的刷新。
+ * 增删树时只改动对应的桶：删除同样采用交换到末尾的方式，不需要重新分桶。
+ */
+class BatchRenderer
+{
+public:
+    struct Instance
+    {
+        int x;
+        int y;
+        int age;
+    };
+
+    struct Batch
+    {
+        TreeType* treeType;
+        std::vector<Instance> instances;
+        std::vector<uint32_t> treeIndices; // 与instances一一对应，删除时回写位置
+    };
+
+    explicit BatchRenderer(size_t bufferSize = 1 << 16) : _buffer(bufferSize) {}
+
+    void rebuild(const std::vector<Tree>& forest)
+    {
+        _batches.clear();
+        _batchOfType.clear();
+        _locations.assign(forest.size(), Location{kNone, 0});
+        for (uint32_t i = 0; i < forest.size(); ++i)
+        {
+            add(i, forest[i]);
+        }
+    }
+
+    void add(uint32_t treeIndex, const Tree& tree)
+    {
+        if (treeIndex >= _locations.size()) _locations.resize(treeIndex + 1, Location{kNone, 0});
+        if (_locations[treeIndex].batch != kNone) return;
+        auto searchRes = _batchOfType.find(tree.GetTreeType());
+        uint32_t batchIndex;
+        if (searchRes != _batchOfType.end())
+        {
+            batchIndex = searchRes->second;
+        }
         else
         {
-            auto pTreeType = new TreeType(name, color, texture);
-            _treeTypes.insert(std::make_pair(key, pTreeType));
-            return pTreeType;
+            batchIndex = static_cast<uint32_t>(_batches.size());
+            _batches.push_back(Batch{tree.GetTreeType(), {}, {}});
+            _batchOfType.insert(std::make_pair(tree.GetTreeType(), batchIndex));
+        }
+        Batch& batch = _batches[batchIndex];
+        _locations[treeIndex] = Location{batchIndex, static_cast<uint32_t>(batch.instances.size())};
+        batch.instances.push_back(Instance{tree.GetX(), tree.GetY(), tree.GetAge()});
+        batch.treeIndices.push_back(treeIndex);
+    }
+
+    void remove(uint32_t treeIndex)
+    {
+        if (treeIndex >= _locations.size() || _locations[treeIndex].batch == kNone) return;
+        Location loc = _locations[treeIndex];
+        Batch& batch = _batches[loc.batch];
+        uint32_t moved = batch.treeIndices.back();
+        batch.instances[loc.slot] = batch.instances.back();
+        batch.treeIndices[loc.slot] = moved;
+        _locations[moved].slot = loc.slot;
+        batch.instances.pop_back();
+        batch.treeIndices.pop_back();
+        _locations[treeIndex].batch = kNone;
+    }
+
+    const std::vector<Batch>& batches() const {return _batches;}
+
+    // 渲染一帧：每个类型输出一次享元数据，随后是该批次的全部实例
+    void render(std::ostream& os)
+    {
+        _used = 0;
+        for (const auto& batch : _batches)
+        {
+            if (batch.instances.empty()) continue;
+            append("Batch: ");
+            append(batch.treeType->GetName());
+            append(", Color: ");
+            append(batch.treeType->GetColor());
+            append(", Instances: ");
+            appendInt(static_cast<long long>(batch.instances.size()));
+            append("\n");
+            for (const auto& inst : batch.instances)
+            {
+                reserve(64, os);
+                append("  Position: (");
+                appendInt(inst.x);
+                append(", ");
+                appendInt(inst.y);
+                append("), Age: ");
+                appendInt(inst.age);
+                append("\n");
+            }
+            reserve(_buffer.size() / 2, os);
         }
+        flush(os);
+        os.flush();
     }
 
 private:
-    std::unordered_map<std::string, TreeType*> _treeTypes;
+    static constexpr uint32_t kNone = UINT32_MAX;
 
-    std::string GenerateKey(const std::string& name, const std::string& color, const std::string& texture)
+    struct Location
+    {
+        uint32_t batch;
+        uint32_t slot;
+    };
+
+    std::vector<Batch> _batches;
+    std::unordered_map<TreeType*, uint32_t> _batchOfType;
+    std::vector<Location> _locations; // 树下标 -> 所在批次及位置
+    std::vector<char> _buffer;
+    size_t _used = 0;
+
+    // 剩余空间不足时先把缓冲区写出
+    void reserve(size_t bytes, std::ostream& os)
+    {
+        if (_used + bytes > _buffer.size()) flush(os);
+    }
+
+    void flush(std::ostream& os)
+    {
+        os.write(_buffer.data(), static_cast<std::streamsize>(_used));
+        _used = 0;
+    }
+
+    // 类型名等较长字符串可能超过剩余空间，需要时扩容
+    void ensure(size_t bytes)
+    {
+        if (_used + bytes > _buffer.size()) _buffer.resize(_used + bytes);
+    }
+
+    void append(const std::string& str)
+    {
+        ensure(str.size());
+        std::copy(str.begin(), str.end(), _buffer.begin() + _used);
+        _used += str.size();
+    }
+
+    template <size_t N>
+    void append(const char (&literal)[N])
+    {
+        ensure(N - 1);
+        std::copy(literal, literal + N - 1, _buffer.begin() + _used);
+        _used += N - 1;
+    }
+
+    void appendInt(long long value)
+    {
+        ensure(24);
+        auto res = std::to_chars(_buffer.data() + _used, _buffer.data() + _buffer.size(), value);
+        _used = res.ptr - _buffer.data();
+    }
+};
+
+/**
+ * 二进制森林文件
+ * 布局：文件头 | 类型表 | 树记录 | 字符串池，各段按8字节对齐。
+ * 类型表中的名称、颜色、纹理都指向字符串池，每种类型只存一份；树记录是定长的紧凑结构，
+ * 通过mmap映射后可以直接按数组遍历，不需要解析，也不需要为每棵树分配内存。
+ */
+namespace forest_file
+{
+constexpr uint32_t kMagic = 0x54535246; // "FRST"
+constexpr uint32_t kVersion = 1;
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t typeCount;
+    uint32_t reserved;
+    uint64_t treeCount;
+    uint64_t typeTableOffset;
+    uint64_t treeOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+};
+
+struct StringRef
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct TypeRecord
+{
+    StringRef name;
+    StringRef color;
+    StringRef texture;
+};
+
+struct TreeRecord
+{
+    int32_t x;
+    int32_t y;
+    int32_t age;
+    uint32_t typeIndex;
+};
+
+static_assert(sizeof(Header) == 56, "Header layout changed");
+static_assert(sizeof(TypeRecord) == 24, "TypeRecord layout changed");
+static_assert(sizeof(TreeRecord) == 16, "TreeRecord layout changed");
+
+inline uint64_t alignUp(uint64_t value) {return (value + 7) & ~uint64_t(7);}
+
+// 写出森林，类型按首次出现的顺序编号
+inline void write(const std::string& path, const std::vector<Tree>& forest)
+{
+    std::unordered_map<TreeType*, uint32_t> typeIndex;
+    std::vector<TypeRecord> types;
+    std::string pool;
+    auto intern = [&pool](const std::string& str) {
+        StringRef ref{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(str.size())};
+        pool += str;
+        return ref;
+    };
+
+    std::vector<TreeRecord> records;
+    records.reserve(forest.size());
+    for (const auto& tree : forest)
+    {
+        TreeType* type = tree.GetTreeType();
+        auto searchRes = typeIndex.find(type);
+        uint32_t index;
+        if (searchRes != typeIndex.end())
+        {
+            index = searchRes->second;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(types.size());
+            types.push_back(TypeRecord{intern(type->GetName()), intern(type->GetColor()), intern(type->GetTexture())});
+            typeIndex.insert(std::make_pair(type, index));
+        }
+        records.push_back(TreeRecord{tree.GetX(), tree.GetY(), tree.GetAge(), index});
+    }
+
+    Header header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.typeCount = static_cast<uint32_t>(types.size());
+    header.treeCount = records.size();
+    header.typeTableOffset = alignUp(sizeof(Header));
+    header.treeOffset = alignUp(header.typeTableOffset + types.size() * sizeof(TypeRecord));
+    header.stringOffset = alignUp(header.treeOffset + records.size() * sizeof(TreeRecord));
+    header.stringSize = pool.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot open " + path);
+    auto padTo = [&out](uint64_t offset) {
+        static const char zeros[8] = {};
+        uint64_t pos = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - pos));
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.typeTableOffset);
+    out.write(reinterpret_cast<const char*>(types.data()), static_cast<std::streamsize>(types.size() * sizeof(TypeRecord)));
+    padTo(header.treeOffset);
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TreeRecord)));
+    padTo(header.stringOffset);
+    out.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+    if (!out) throw std::runtime_error("Failed to write " + path);
+}
+
+// [offset, offset + count * recordSize) 是否完整地落在文件内
+inline bool fitsInFile(uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t size)
+{
+    return offset <= size && count <= (size - offset) / recordSize;
+}
+
+// 检查文件结构是否完整，出错时返回false并给出原因
+inline bool validate(const char* data, size_t size, std::string& error)
+{
+    if (size < sizeof(Header)) {error = "file too small"; return false;}
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (header->magic != kMagic) {error = "bad magic"; return false;}
+    if (header->version != kVersion) {error = "unsupported version"; return false;}
+    // 先比较再相减、先相除再比较，避免偏移和数量过大时回绕
+    if (header->typeTableOffset < sizeof(Header) || header->typeTableOffset % 8 ||
+        !fitsInFile(header->typeTableOffset, header->typeCount, sizeof(TypeRecord), size))
+    {
+        error = "type table out of range";
+        return false;
+    }
+    uint64_t typeEnd = header->typeTableOffset + uint64_t(header->typeCount) * sizeof(TypeRecord);
+    if (header->treeOffset < typeEnd || header->treeOffset % 8 ||
+        !fitsInFile(header->treeOffset, header->treeCount, sizeof(TreeRecord), size))
+    {
+        error = "tree records out of range";
+        return false;
+    }
+    uint64_t treeEnd = header->treeOffset + header->treeCount * sizeof(TreeRecord);
+    if (header->stringOffset < treeEnd || !fitsInFile(header->stringOffset, header->stringSize, 1, size))
+    {
+        error = "string pool out of range";
+        return false;
+    }
+    const TypeRecord* types = reinterpret_cast<const TypeRecord*>(data + header->typeTableOffset);
+    for (uint32_t i = 0; i < header->typeCount; ++i)
+    {
+        for (const StringRef& ref : {types[i].name, types[i].color, types[i].texture})
+        {
+            if (uint64_t(ref.offset) + ref.length > header->stringSize)
+            {
+                error = "type " + std::to_string(i) + " string out of range";
+                return false;
+            }
+        }
+    }
+    const TreeRecord* trees = reinterpret_cast<const TreeRecord*>(data + header->treeOffset);
+    for (uint64_t i = 0; i < header->treeCount; ++i)
+    {
+        if (trees[i].typeIndex >= header->typeCount)
+        {
+            error = "tree " + std::to_string(i) + " has invalid type index";
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace forest_file
+
+// 只读映射的森林文件，构造时完成映射和校验，析构时解除映射
+class MappedForest
+{
+public:
+    explicit MappedForest(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        _size = static_cast<size_t>(st.st_size);
+        void* addr = _size ? ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (addr == MAP_FAILED) throw std::runtime_error("Cannot map " + path);
+        _data = static_cast<const char*>(addr);
+
+        std::string error;
+        if (!forest_file::validate(_data, _size, error))
+        {
+            ::munmap(const_cast<char*>(_data), _size);
+            throw std::runtime_error("Invalid forest file " + path + ": " + error);
+        }
+        _header = reinterpret_cast<const forest_file::Header*>(_data);
+    }
+
+    ~MappedForest()
     {
-        return name + color + texture;
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+
+    MappedForest(const MappedForest&) = delete;
+    MappedForest& operator=(const MappedForest&) = delete;
+
+    uint64_t treeCount() const {return _header->treeCount;}
+    uint32_t typeCount() const {return _header->typeCount;}
+
+    const forest_file::TreeRecord* trees() const
+    {
+        return reinterpret_cast<const forest_file::TreeRecord*>(_data + _header->treeOffset);
+    }
+
+    std::string_view typeName(uint32_t type) const {return str(typeRecord(type).name);}
+    std::string_view typeColor(uint32_t type) const {return str(typeRecord(type).color);}
+    std::string_view typeTexture(uint32_t type) const {return str(typeRecord(type).texture);}
+
+    // 按类型表把享元注册到工厂中，每种类型只查找一次
+    std::vector<TreeType*> resolveTypes(TreeFactory& factory) const
+    {
+        std::vector<TreeType*> types;
+        types.reserve(typeCount());
+        for (uint32_t i = 0; i < typeCount(); ++i)
+        {
+            types.push_back(factory.getTreeType(std::string(typeName(i)), std::string(typeColor(i)),
+                                                std::string(typeTexture(i))));
+        }
+        return types;
+    }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    const forest_file::Header* _header = nullptr;
+
+    const forest_file::TypeRecord& typeRecord(uint32_t type) const
+    {
+        return reinterpret_cast<const forest_file::TypeRecord*>(_data + _header->typeTableOffset)[type];
+    }
+
+    std::string_view str(forest_file::StringRef ref) const
+    {
+        return std::string_view(_data + _header->stringOffset + ref.offset, ref.length);
     }
 };
 
+/**
+ * 并行批量生成与聚合
+ * 森林按块切分，各线程通过原子计数器领取下一块，负载不均时也能自动平衡。
+ * 生成时每个线程维护自己的类型缓存，只有缓存未命中才加锁访问共享的TreeFactory。
+ */
+namespace parallel_forest
+{
+struct TreeSpec
+{
+    int x;
+    int y;
+    int age;
+    std::string_view name;
+    std::string_view color;
+    std::string_view texture;
+};
+
+inline unsigned defaultThreads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 把[0, count)按块分给threads个线程执行，body(begin, end, threadIndex)
+template <typename Body>
+void forEachChunk(size_t count, unsigned threads, size_t chunkSize, Body body)
+{
+    threads = std::max(1u, threads);
+    std::atomic<size_t> next{0};
+    auto worker = [&](unsigned threadIndex) {
+        for (;;)
+        {
+            size_t begin = next.fetch_add(chunkSize);
+            if (begin >= count) break;
+            body(begin, std::min(count, begin + chunkSize), threadIndex);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+}
+
+// generator(index)返回TreeSpec，结果按下标写入forest，与线程数无关
+template <typename Generator>
+void generate(std::vector<Tree>& forest, size_t count, TreeFactory& factory, Generator generator,
+              unsigned threads = defaultThreads(), size_t chunkSize = 1 << 16)
+{
+    forest.resize(count);
+    threads = std::max(1u, threads);
+    std::mutex factoryMutex;
+    // 每个线程一份缓存，生命周期限定在本次调用内，避免缓存指向其他工厂的享元
+    struct TypeCache
+    {
+        std::unordered_map<std::string, TreeType*> types;
+        std::string key;
+    };
+    std::vector<TypeCache> caches(threads);
+    forEachChunk(count, threads, chunkSize, [&](size_t begin, size_t end, unsigned threadIndex) {
+        auto& cache = caches[threadIndex].types;
+        std::string& key = caches[threadIndex].key;
+        for (size_t i = begin; i < end; ++i)
+        {
+            TreeSpec spec = generator(i);
+            key.assign(spec.name).append(1, '\0').append(spec.color).append(1, '\0').append(spec.texture);
+            auto searchRes = cache.find(key);
+            TreeType* type;
+            if (searchRes != cache.end())
+            {
+                type = searchRes->second;
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(factoryMutex);
+                type = factory.getTreeType(std::string(spec.name), std::string(spec.color), std::string(spec.texture));
+                cache.insert(std::make_pair(key, type));
+            }
+            forest[i] = Tree(spec.x, spec.y, spec.age, type);
+        }
+    });
+}
+
+// 通用并行归约：每个线程先在局部结果上累加，最后合并各线程的局部结果。
+// 块是动态领取的，哪些元素落进哪个局部结果、以什么顺序累加，每次运行都可能不同，
+// 因此accumulate的累加顺序不能影响结果，merge必须同时满足结合律和交换律（计数、求和、直方图都满足）
+template <typename Result, typename Accumulate, typename Merge>
+Result reduce(const std::vector<Tree>& forest, Result init, Accumulate accumulate, Merge merge,
+              unsigned threads = defaultThreads(), size_t chunkSize = 1 << 16)
+{
+    threads = std::max(1u, threads);
+    std::vector<Result> partial(threads, init);
+    forEachChunk(forest.size(), threads, chunkSize, [&](size_t begin, size_t end, unsigned threadIndex) {
+        Result& local = partial[threadIndex];
+        for (size_t i = begin; i < end; ++i) accumulate(local, forest[i]);
+    });
+    Result result = init;
+    for (auto& local : partial) merge(result, local);
+    return result;
+}
+
+inline std::unordered_map<TreeType*, size_t> countByType(const std::vector<Tree>& forest,
+                                                         unsigned threads = defaultThreads())
+{
+    using Counts = std::unordered_map<TreeType*, size_t>;
+    return reduce(forest, Counts{},
+        [](Counts& counts, const Tree& tree) {++counts[tree.GetTreeType()];},
+        [](Counts& result, const Counts& local) {
+            for (const auto& item : local) result[item.first] += item.second;
+        },
+        threads);
+}
+
+// 年龄直方图，超出范围的年龄计入首尾两个桶；桶宽和桶数必须为正，否则抛出invalid_argument
+inline std::vector<size_t> ageHistogram(const std::vector<Tree>& forest, int bucketWidth, size_t bucketCount,
+                                        unsigned threads = defaultThreads())
+{
+    if (bucketWidth <= 0) throw std::invalid_argument("bucketWidth must be positive");
+    if (bucketCount == 0) throw std::invalid_argument("bucketCount must be positive");
+    using Histogram = std::vector<size_t>;
+    return reduce(forest, Histogram(bucketCount, 0),
+        [bucketWidth, bucketCount](Histogram& hist, const Tree& tree) {
+            long long bucket = tree.GetAge() / bucketWidth;
+            bucket = std::clamp<long long>(bucket, 0, static_cast<long long>(bucketCount) - 1);
+            ++hist[static_cast<size_t>(bucket)];
+        },
+        [](Histogram& result, const Histogram& local) {
+            for (size_t i = 0; i < result.size(); ++i) result[i] += local[i];
+        },
+        threads);
+}
+} // namespace parallel_forest
+
+// 生成随机森林，供各项性能测试使用
+static std::vector<Tree> buildRandomForest(TreeFactory& factory, size_t treeCount, int world)
+{
+    std::vector<TreeType*> types = {
+        factory.getTreeType("Oak", "Green", "OakTexture"),
+        factory.getTreeType("Pine", "DarkGreen", "PineTexture"),
+        factory.getTreeType("Birch", "White", "BirchTexture"),
+        factory.getTreeType("Maple", "Red", "MapleTexture"),
+    };
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pos(0, world - 1);
+    std::vector<Tree> forest;
+    forest.reserve(treeCount);
+    for (size_t i = 0; i < treeCount; ++i)
+    {
+        forest.emplace_back(pos(rng), pos(rng), static_cast<int>(i % 100), types[i % types.size()]);
+    }
+    return forest;
+}
+
+// 性能测试：不同规模森林、不同视口大小下的区域查询吞吐
+static void benchmarkGridQuery(size_t treeCount)
+{
+    using Clock = std::chrono::steady_clock;
+    const int world = 100000;
+    TreeFactory factory;
+    std::vector<Tree> forest = buildRandomForest(factory, treeCount, world);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pos(0, world - 1);
+
+    auto t0 = Clock::now();
+    TreeGrid grid(forest, 0, 0, world, world, 500);
+    grid.bulkLoad();
+    double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    std::cout << "trees=" << treeCount << " bulkLoad=" << buildMs << "ms" << std::endl;
+
+    std::vector<uint32_t> result;
+    for (int view : {500, 2000, 10000})
+    {
+        const int queries = 200;
+        size_t hits = 0;
+        auto start = Clock::now();
+        for (int q = 0; q < queries; ++q)
+        {
+            int x = pos(rng) % (world - view), y = pos(rng) % (world - view);
+            result.clear();
+            grid.query(x, y, x + view - 1, y + view - 1, result);
+            hits += result.size();
+        }
+        double sec = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  viewport=" << view << "x" << view << " grid: " << queries / sec << " queries/s"
+                  << ", avg hits=" << hits / queries;
+
+        // 对照：全量扫描
+        const int scanQueries = 5;
+        auto scanStart = Clock::now();
+        for (int q = 0; q < scanQueries; ++q)
+        {
+            int x = pos(rng) % (world - view), y = pos(rng) % (world - view);
+            result.clear();
+            for (uint32_t i = 0; i < forest.size(); ++i)
+            {
+                const Tree& tree = forest[i];
+                if (tree.GetX() >= x && tree.GetX() < x + view && tree.GetY() >= y && tree.GetY() < y + view)
+                {
+                    result.push_back(i);
+                }
+            }
+        }
+        double scanSec = std::chrono::duration<double>(Clock::now() - scanStart).count();
+        std::cout << ", full scan: " << scanQueries / scanSec << " queries/s" << std::endl;
+    }
+}
+
+// 性能测试：逐棵display与分桶批量渲染的单帧耗时，输出到/dev/null以排除终端的影响
+static void benchmarkBatchRender(size_t treeCount)
+{
+    using Clock = std::chrono::steady_clock;
+    TreeFactory factory;
+    std::vector<Tree> forest = buildRandomForest(factory, treeCount, 100000);
+    std::ofstream devNull("/dev/null");
+
+    auto t0 = Clock::now();
+    std::streambuf* coutBuf = std::cout.rdbuf(devNull.rdbuf());
+    for (auto& tree : forest) tree.display();
+    std::cout.rdbuf(coutBuf);
+    double perTreeMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+    BatchRenderer renderer;
+    auto t1 = Clock::now();
+    renderer.rebuild(forest);
+    double rebuildMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+
+    const int frames = 5;
+    auto t2 = Clock::now();
+    for (int f = 0; f < frames; ++f) renderer.render(devNull);
+    double batchMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count() / frames;
+
+    // 每帧增删1%的树，模拟增量变化
+    size_t churn = std::max<size_t>(1, treeCount / 100);
+    auto t3 = Clock::now();
+    for (uint32_t i = 0; i < churn; ++i) renderer.remove(i);
+    for (uint32_t i = 0; i < churn; ++i) renderer.add(i, forest[i]);
+    double churnMs = std::chrono::duration<double, std::milli>(Clock::now() - t3).count();
+
+    std::cout << "trees=" << treeCount << " per-tree display=" << perTreeMs << "ms/frame"
+              << ", batch render=" << batchMs << "ms/frame"
+              << ", rebucket all=" << rebuildMs << "ms"
+              << ", incremental remove+add " << churn << " trees=" << churnMs << "ms" << std::endl;
+}
+
+// 性能测试：mmap零拷贝加载与逐个构造Tree的启动耗时对比
+static void benchmarkForestFile(size_t treeCount)
+{
+    using Clock = std::chrono::steady_clock;
+    const std::string path = "/tmp/forest_bench.bin";
+    {
+        TreeFactory factory;
+        std::vector<Tree> forest = buildRandomForest(factory, treeCount, 100000);
+        auto t0 = Clock::now();
+        forest_file::write(path, forest);
+        double writeMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        std::cout << "trees=" << treeCount << " write=" << writeMs << "ms";
+    }
+
+    // 映射 + 校验 + 遍历一遍
+    auto t1 = Clock::now();
+    long long ageSum = 0;
+    {
+        MappedForest mapped(path);
+        const forest_file::TreeRecord* trees = mapped.trees();
+        for (uint64_t i = 0; i < mapped.treeCount(); ++i) ageSum += trees[i].age;
+    }
+    double mmapMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+
+    // 逐棵树通过工厂查找类型并构造Tree对象
+    auto t2 = Clock::now();
+    long long ageSum2 = 0;
+    {
+        std::ifstream in(path, std::ios::binary);
+        forest_file::Header header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        std::vector<forest_file::TypeRecord> typeRecords(header.typeCount);
+        in.seekg(static_cast<std::streamoff>(header.typeTableOffset));
+        in.read(reinterpret_cast<char*>(typeRecords.data()), typeRecords.size() * sizeof(forest_file::TypeRecord));
+        std::string pool(header.stringSize, '\0');
+        in.seekg(static_cast<std::streamoff>(header.stringOffset));
+        in.read(pool.data(), static_cast<std::streamsize>(pool.size()));
+        in.seekg(static_cast<std::streamoff>(header.treeOffset));
+
+        TreeFactory factory;
+        std::vector<Tree> forest;
+        forest_file::TreeRecord rec;
+        for (uint64_t i = 0; i < header.treeCount; ++i)
+        {
+            in.read(reinterpret_cast<char*>(&rec), sizeof(rec));
+            const auto& t = typeRecords[rec.typeIndex];
+            forest.emplace_back(rec.x, rec.y, rec.age,
+                                factory.getTreeType(pool.substr(t.name.offset, t.name.length),
+                                                    pool.substr(t.color.offset, t.color.length),
+                                                    pool.substr(t.texture.offset, t.texture.length)));
+        }
+        for (const auto& tree : forest) ageSum2 += tree.GetAge();
+    }
+    double constructMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count();
+
+    std::cout << ", mmap load+iterate=" << mmapMs << "ms"
+              << ", per-object construction=" << constructMs << "ms"
+              << (ageSum == ageSum2 ? "" : " (MISMATCH)") << std::endl;
+
+    // 篡改头部的偏移和数量，校验必须拒绝而不是越界读
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    size_t fileSize = static_cast<size_t>(in.tellg());
+    std::vector<uint64_t> image((fileSize + 7) / 8);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(image.data()), static_cast<std::streamsize>(fileSize));
+    const std::vector<std::function<void(forest_file::Header&)>> corruptions = {
+        [](forest_file::Header& h) { h.typeTableOffset = ~uint64_t(0) - 7; h.typeCount = 1; },
+        [](forest_file::Header& h) { h.treeOffset = ~uint64_t(0) - 7; },
+        [](forest_file::Header& h) { h.treeCount = ~uint64_t(0) / sizeof(forest_file::TreeRecord) + 2; },
+        [](forest_file::Header& h) { h.stringOffset = ~uint64_t(0) - 7; },
+        [](forest_file::Header& h) { h.stringSize = ~uint64_t(0); },
+    };
+    size_t rejected = 0;
+    for (const auto& corrupt : corruptions)
+    {
+        std::vector<uint64_t> copy = image;
+        corrupt(*reinterpret_cast<forest_file::Header*>(copy.data()));
+        std::string error;
+        if (!forest_file::validate(reinterpret_cast<const char*>(copy.data()), fileSize, error)) ++rejected;
+    }
+    std::cout << "malformed headers rejected: " << rejected << "/" << corruptions.size() << std::endl;
+    std::remove(path.c_str());
+}
+
+// 性能测试：并行生成与聚合从1个线程扩展到N个线程
+static void benchmarkParallelForest(size_t treeCount)
+{
+    using Clock = std::chrono::steady_clock;
+    static const std::string_view names[] = {"Oak", "Pine", "Birch", "Maple"};
+    static const std::string_view colors[] = {"Green", "DarkGreen", "White", "Red"};
+    static const std::string_view textures[] = {"OakTexture", "PineTexture", "BirchTexture", "MapleTexture"};
+    // 基于下标的哈希生成，保证不同线程数得到相同的森林
+    auto generator = [](size_t i) {
+        uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        size_t t = h % 4;
+        return parallel_forest::TreeSpec{static_cast<int>(h % 100000), static_cast<int>((h >> 20) % 100000),
+                                         static_cast<int>((h >> 40) % 100), names[t], colors[t], textures[t]};
+    };
+
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < parallel_forest::defaultThreads(); t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(parallel_forest::defaultThreads());
+
+    std::cout << "trees=" << treeCount << std::endl;
+    for (unsigned threads : threadCounts)
+    {
+        TreeFactory factory;
+        std::vector<Tree> forest;
+        auto t0 = Clock::now();
+        parallel_forest::generate(forest, treeCount, factory, generator, threads);
+        double genMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        auto t1 = Clock::now();
+        auto counts = parallel_forest::countByType(forest, threads);
+        double countMs = std::chrono::duration<double, std::milli>(Clock::now() - t1).count();
+
+        auto t2 = Clock::now();
+        auto hist = parallel_forest::ageHistogram(forest, 10, 10, threads);
+        double histMs = std::chrono::duration<double, std::milli>(Clock::now() - t2).count();
+
+        std::cout << "  threads=" << threads << " generate=" << genMs << "ms"
+                  << ", countByType=" << countMs << "ms (" << counts.size() << " types)"
+                  << ", ageHistogram=" << histMs << "ms (first bucket " << hist[0] << ")" << std::endl;
+    }
+
+    // 按实际使用的树计算享元节省的内存
+    TreeFactory factory;
+    std::vector<Tree> forest;
+    parallel_forest::generate(forest, treeCount, factory, generator, parallel_forest::defaultThreads());
+    TreeFactory::Stats stats = factory.stats(forest);
+    std::cout << "types=" << stats.liveTypes << " uses=" << stats.uses << " shared bytes=" << stats.sharedBytes
+              << " saved bytes=" << stats.savedBytes << std::endl;
+}
 
 // 客户端测试代码
-int main() {
+// 运行 ./flyWeight_adjustedAns bench <grid|batch|file|parallel> [树的数量...] 进行性能测试，建议使用 -O2 编译
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "bench")
+    {
+        std::string name = argv[2];
+        std::vector<size_t> sizes;
+        for (int i = 3; i < argc; ++i) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+        if (name == "grid")
+        {
+            if (sizes.empty()) sizes = {1000000, 10000000};
+            for (size_t n : sizes) benchmarkGridQuery(n);
+        }
+        else if (name == "batch")
+        {
+            if (sizes.empty()) sizes = {1000000};
+            for (size_t n : sizes) benchmarkBatchRender(n);
+        }
+        else if (name == "file")
+        {
+            if (sizes.empty()) sizes = {1000000};
+            for (size_t n : sizes) benchmarkForestFile(n);
+        }
+        else if (name == "parallel")
+        {
+            if (sizes.empty()) sizes = {10000000};
+            for (size_t n : sizes) benchmarkParallelForest(n);
+        }
+        else
+        {
+            std::cout << "Unknown benchmark: " << name << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     TreeFactory factory;
 
     // 创建多棵树，验证享元模式
@@ -98,5 +1228,70 @@ int main() {
     std::cout << "Oak Type Address: " << oakType << std::endl;
     std::cout << "Pine Type Address: " << pineType << std::endl;
 
+    // 空间索引：只查询视口内的树
+    std::vector<Tree> forest = {oak1, oak2, oak3, pine};
+    TreeGrid grid(forest, 0, 0, 1000, 1000, 50);
+    grid.bulkLoad();
+    std::vector<uint32_t> visible;
+    grid.query(0, 0, 60, 60, visible);
+    std::cout << "Trees in viewport (0, 0)-(60, 60): " << visible.size() << std::endl;
+    for (TreeType* type : grid.visibleTypes(visible))
+    {
+        std::cout << "Visible type: " << type->GetName() << std::endl;
+    }
+    grid.remove(0);
+    visible.clear();
+    grid.query(0, 0, 60, 60, visible);
+    std::cout << "After removing oak1: " << visible.size() << std::endl;
+
+    // 批量渲染：同类型的树合并为一个批次输出
+    BatchRenderer renderer;
+    renderer.rebuild(forest);
+    renderer.render(std::cout);
+
+    // 写出二进制森林文件，再通过mmap直接遍历
+    forest_file::write("forest.bin", forest);
+    {
+        MappedForest mapped("forest.bin");
+        std::cout << "Mapped forest: " << mapped.treeCount() << " trees, " << mapped.typeCount() << " types" << std::endl;
+        const forest_file::TreeRecord* trees = mapped.trees();
+        for (uint64_t i = 0; i < mapped.treeCount(); ++i)
+        {
+            std::cout << "Tree: " << mapped.typeName(trees[i].typeIndex)
+                      << ", Position: (" << trees[i].x << ", " << trees[i].y << ")" << std::endl;
+        }
+    }
+    std::remove("forest.bin");
+
+    // 引用计数的享元：总字节数超出预算时淘汰引用归零的享元
+    TreeFactory streamingFactory(150);
+    TreeType* cedar = streamingFactory.acquire("Cedar", "Green", "CedarTexture");
+    TreeType* cedar2 = streamingFactory.acquire("Cedar", "Green", "CedarTexture");
+    TreeType* willow = streamingFactory.acquire("Willow", "LightGreen", "WillowTexture");
+    auto printStats = [&streamingFactory](const char* label) {
+        TreeFactory::Stats stats = streamingFactory.stats();
+        std::cout << label << ": live=" << stats.liveTypes << ", unused=" << stats.unusedTypes
+                  << ", refs=" << stats.references << ", uses=" << stats.uses << ", shared bytes=" << stats.sharedBytes
+                  << ", saved bytes=" << stats.savedBytes << ", evicted=" << stats.evictedTypes << std::endl;
+    };
+    printStats("After acquire");
+    streamingFactory.release(cedar);
+    streamingFactory.release(cedar2);
+    streamingFactory.release(willow);
+    printStats("After release");
+    streamingFactory.evictUnused();
+    printStats("After evict");
+
+    // 并行生成一片森林并统计每种类型的数量
+    std::vector<Tree> generated;
+    parallel_forest::generate(generated, 1000, factory, [](size_t i) {
+        return i % 3 == 0 ? parallel_forest::TreeSpec{static_cast<int>(i), 0, 1, "Pine", "DarkGreen", "PineTexture"}
+                          : parallel_forest::TreeSpec{static_cast<int>(i), 0, 2, "Oak", "Green", "OakTexture"};
+    });
+    for (const auto& item : parallel_forest::countByType(generated))
+    {
+        std::cout << "Generated " << item.first->GetName() << ": " << item.second << std::endl;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,10 @@
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <optional>
 
 /**
  * parseRole写成私有静态方法的原因
@@ -13,10 +17,77 @@ enum class UserRole
 {
     Admin,
     User,
-    Guest,
-    Unknown
+    Guest
 };
 
+enum class FileOp
+{
+    Read,
+    Write
+};
+
+// 拒绝访问走错误码路径，不再依赖异常
+enum class FileError
+{
+    None,
+    PermissionDenied,
+    UnknownRole
+};
+
+inline const char* errorMessage(FileError error)
+{
+    switch (error)
+    {
+    case FileError::None: return "OK";
+    case FileError::PermissionDenied: return "Permission denied";
+    case FileError::UnknownRole: return "Unknown role";
+    }
+    return "Unknown error";
+}
+
+/**
+ * 预编译的访问控制表：每个(角色, 操作)对占一位，第 role * OpCount + op 位为1表示允许。
+ * 检查权限只需一次移位和按位与，取代逐个角色的if/else判断
+ */
+class Acl
+{
+public:
+    static constexpr unsigned OpCount = 2;
+
+    constexpr Acl() : _mask(0) {}
+
+    constexpr Acl allow(UserRole role, FileOp op) const
+    {
+        return Acl(static_cast<uint16_t>(_mask | bit(role, op)));
+    }
+
+    constexpr bool allows(UserRole role, FileOp op) const { return (_mask & bit(role, op)) != 0; }
+
+    // 某个角色的所有操作位，移到最低位，便于按角色缓存
+    constexpr uint16_t roleBits(UserRole role) const
+    {
+        return static_cast<uint16_t>((_mask >> (static_cast<unsigned>(role) * OpCount)) & ((1u << OpCount) - 1));
+    }
+
+    static constexpr uint16_t opBit(FileOp op) { return static_cast<uint16_t>(1u << static_cast<unsigned>(op)); }
+
+private:
+    uint16_t _mask;
+
+    constexpr explicit Acl(uint16_t mask) : _mask(mask) {}
+
+    static constexpr uint16_t bit(UserRole role, FileOp op)
+    {
+        return static_cast<uint16_t>(opBit(op) << (static_cast<unsigned>(role) * OpCount));
+    }
+};
+
+// 默认策略：管理员读写，普通用户只读，访客无权限
+constexpr Acl kDefaultAcl = Acl()
+    .allow(UserRole::Admin, FileOp::Read)
+    .allow(UserRole::Admin, FileOp::Write)
+    .allow(UserRole::User, FileOp::Read);
+
 class File
 {
 public:
@@ -49,11 +120,31 @@ private:
 class ProxyFile : public File
 {
 public:
-    ProxyFile(std::string fileName, std::string userLevel)
-     : _fileName(fileName)
+    // 角色只在构造时解析一次，并把该角色在ACL中的权限位缓存下来；无法识别的角色抛出invalid_argument
+    ProxyFile(std::string fileName, std::string userLevel, Acl acl = kDefaultAcl)
+     : ProxyFile(fileName, requireRole(userLevel), acl) {}
+
+    ProxyFile(std::string fileName, UserRole role, Acl acl = kDefaultAcl)
+     : _fileName(fileName), _userRole(role), _permissions(acl.roleBits(role))
     {
         pRealFile = new RealFile(fileName);
-        _userRole = parseRole(userLevel);
+    }
+
+    ProxyFile(const ProxyFile&) = delete;
+    ProxyFile& operator=(const ProxyFile&) = delete;
+
+    // 错误码形式的工厂：角色无法识别时返回空指针并把error置为UnknownRole，不抛异常
+    static std::unique_ptr<ProxyFile> create(const std::string& fileName, const std::string& userLevel,
+                                             FileError& error, Acl acl = kDefaultAcl)
+    {
+        std::optional<UserRole> role = parseRole(userLevel);
+        if (!role)
+        {
+            error = FileError::UnknownRole;
+            return nullptr;
+        }
+        error = FileError::None;
+        return std::make_unique<ProxyFile>(fileName, *role, acl);
     }
 
     ~ProxyFile()
@@ -61,61 +152,134 @@ public:
         delete pRealFile;
     }
 
+    // 错误码接口：拒绝时返回PermissionDenied，不抛异常
+    FileError tryRead(std::string& content)
+    {
+        if (!permits(FileOp::Read)) return FileError::PermissionDenied;
+        content = pRealFile->read();
+        return FileError::None;
+    }
+
+    FileError tryWrite(const std::string& content)
+    {
+        if (!permits(FileOp::Write)) return FileError::PermissionDenied;
+        pRealFile->write(content);
+        return FileError::None;
+    }
+
+    // File接口保持原有语义：拒绝时抛出异常
     std::string read() override
     {
-        if (_userRole == UserRole::Admin)
-        {
-            return pRealFile->read();
-        }
-        else if (_userRole == UserRole::User)
-        {
-            return pRealFile->read();
-        }
-        else if (_userRole == UserRole::Guest)
-        {
-            throw std::runtime_error("Permission denied");
-        }
-        else
-        {
-            throw std::runtime_error("Permission denied");
-        }
+        if (!permits(FileOp::Read)) throw std::runtime_error(errorMessage(FileError::PermissionDenied));
+        return pRealFile->read();
     }
 
     void write(std::string content) override
     {
-        if (_userRole == UserRole::Admin)
-        {
-            pRealFile->write(content);
-        }
-        else if (_userRole == UserRole::User)
-        {
-            throw std::runtime_error("Permission denied");
-        }
-        else if (_userRole == UserRole::Guest)
-        {
-            throw std::runtime_error("Permission denied");
-        }
-        else
-        {
-            throw std::runtime_error("Permission denied");
-        }
+        if (!permits(FileOp::Write)) throw std::runtime_error(errorMessage(FileError::PermissionDenied));
+        pRealFile->write(content);
     }
 
+    UserRole role() const { return _userRole; }
+
 private:
     std::string _fileName;
     UserRole _userRole;
+    uint16_t _permissions;
     RealFile* pRealFile;
 
-    static UserRole parseRole(const std::string& role_str) {
+    bool permits(FileOp op) const { return (_permissions & Acl::opBit(op)) != 0; }
+
+    static std::optional<UserRole> parseRole(const std::string& role_str) {
         if (role_str == "admin") return UserRole::Admin;
         else if (role_str == "user") return UserRole::User;
         else if (role_str == "guest") return UserRole::Guest;
-        else return UserRole::Unknown;
+        else return std::nullopt;
+    }
+
+    static UserRole requireRole(const std::string& role_str)
+    {
+        std::optional<UserRole> role = parseRole(role_str);
+        if (!role) throw std::invalid_argument(std::string(errorMessage(FileError::UnknownRole)) + ": " + role_str);
+        return *role;
     }
 };
 
+// 性能测试：授权读取相对直接读取RealFile的开销，以及错误码与异常两种拒绝路径的代价
+static void benchmarkAccessControl(size_t iterations)
+{
+    using Clock = std::chrono::steady_clock;
+    auto nsPerOp = [&](auto&& op) {
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) op();
+        return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / iterations;
+    };
+    volatile size_t sink = 0;
+
+    RealFile real("data.txt");
+    File* direct = &real;
+    ProxyFile user("data.txt", "user");
+    std::string content;
+    double directNs = nsPerOp([&] { sink = sink + direct->read().size(); });
+    double proxyNs = nsPerOp([&] { sink = sink + user.read().size(); });
+    double proxyCodeNs = nsPerOp([&] {
+        if (user.tryRead(content) == FileError::None) sink = sink + content.size();
+    });
+    std::cout << "authorized read: direct=" << directNs << "ns proxy read()=" << proxyNs
+              << "ns proxy tryRead()=" << proxyCodeNs << "ns" << std::endl;
+
+    ProxyFile guest("data.txt", "guest");
+    double codeDenyNs = nsPerOp([&] {
+        if (guest.tryWrite("x") == FileError::PermissionDenied) sink = sink + 1;
+    });
+    size_t throwIterations = iterations / 100;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < throwIterations; ++i)
+    {
+        try
+        {
+            guest.write("x");
+        }
+        catch (const std::runtime_error&)
+        {
+            sink = sink + 1;
+        }
+    }
+    double throwDenyNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / throwIterations;
+    std::cout << "denied write: error code=" << codeDenyNs << "ns exception=" << throwDenyNs << "ns" << std::endl;
+}
+
+// 运行 ./proxy_adjustedAns bench acl 进行性能测试，建议使用 -O2 编译
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "bench")
+    {
+        std::string name = argv[2];
+        if (name == "acl")
+        {
+            benchmarkAccessControl(10000000);
+        }
+        else
+        {
+            std::cout << "Unknown benchmark: " << name << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // 错误码接口：拒绝访问不抛异常
+    ProxyFile readOnly("data.txt", "user");
+    FileError error = readOnly.tryWrite("test");
+    std::cout << "tryWrite: " << errorMessage(error) << std::endl;
+
+    // 角色拼写错误在构造时就报告，而不是等到访问时才被当作无权限
+    std::unique_ptr<ProxyFile> typo = ProxyFile::create("data.txt", "amdin", error);
+    std::cout << "create(\"amdin\"): " << errorMessage(error) << std::endl;
+    try {
+        ProxyFile rejected("data.txt", "amdin");
+    } catch (const std::invalid_argument& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+    }
 
-int main() {
     try {
         // 管理员正常读写
         File* adminFile = new ProxyFile("data.txt", "admin");